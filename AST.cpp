@@ -45,6 +45,10 @@ Scope* AST::getRootScope() {
     return &mRootScope;
 }
 
+Arena* AST::getArena() {
+    return &mArena;
+}
+
 // used by the parser.
 void AST::addSyntaxError() {
     mSyntaxErrors++;
@@ -90,6 +94,10 @@ bool AST::containsInterfaces() const {
 status_t AST::postParse() {
     status_t err;
 
+    // parseLazilyImportedFiles is before any pass, as parsing
+    // an import runs the passes of the imported AST.
+    err = parseLazilyImportedFiles();
+    if (err != OK) return err;
     // lookupTypes is the first pass.
     err = lookupTypes();
     if (err != OK) return err;
@@ -127,120 +135,156 @@ status_t AST::postParse() {
             return OK;
         },
         true /* processBeforeDependencies */);
-    std::unordered_set<const Type*> visited;
-    mRootScope.recursivePass(
-        [](Type* type) {
-            type->setPostParseCompleted();
-            return OK;
-        },
-        &visited);
+    mRootScope.recursivePass([](Type* type) {
+        type->setPostParseCompleted();
+        return OK;
+    });
 
     return OK;
 }
 
 status_t AST::constantExpressionRecursivePass(
     const std::function<status_t(ConstantExpression*)>& func, bool processBeforeDependencies) {
-    std::unordered_set<const Type*> visitedTypes;
-    std::unordered_set<const ConstantExpression*> visitedCE;
-    return mRootScope.recursivePass(
-        [&](Type* type) -> status_t {
-            for (auto* ce : type->getConstantExpressions()) {
-                status_t err = ce->recursivePass(func, &visitedCE, processBeforeDependencies);
-                if (err != OK) return err;
-            }
-            return OK;
-        },
-        &visitedTypes);
+    size_t generation = ConstantExpression::beginPass();
+    return mRootScope.recursivePass([&](Type* type) -> status_t {
+        return type->forEachConstantExpression([&](ConstantExpression* ce) {
+            return ce->recursivePass(func, generation, processBeforeDependencies);
+        });
+    });
 }
 
 status_t AST::lookupTypes() {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(
-        [&](Type* type) -> status_t {
-            Scope* scope = type->isScope() ? static_cast<Scope*>(type) : type->parent();
-
-            for (auto* nextRef : type->getReferences()) {
-                if (nextRef->isResolved()) {
-                    continue;
-                }
+    return mRootScope.recursivePass([&](Type* type) -> status_t {
+        Scope* scope = type->isScope() ? static_cast<Scope*>(type) : type->parent();
 
-                Type* nextType = lookupType(nextRef->getLookupFqName(), scope);
-                if (nextType == nullptr) {
-                    std::cerr << "ERROR: Failed to lookup type '"
-                              << nextRef->getLookupFqName().string() << "' at "
-                              << nextRef->location() << "\n";
-                    return UNKNOWN_ERROR;
-                }
-                nextRef->set(nextType);
+        return type->forEachReference([&](Reference<Type>* nextRef) -> status_t {
+            if (nextRef->isResolved()) {
+                return OK;
+            }
+
+            Type* nextType = lookupType(nextRef->getLookupFqName(), scope);
+            if (nextType == nullptr) {
+                std::cerr << "ERROR: Failed to lookup type '"
+                          << nextRef->getLookupFqName().string() << "' at "
+                          << nextRef->location() << "\n";
+                return UNKNOWN_ERROR;
             }
+            nextRef->set(nextType);
 
             return OK;
-        },
-        &visited);
+        });
+    });
+}
+
+status_t AST::parseLazilyImportedFiles() {
+    if (mLazilyImportedPackages.empty()) return OK;
+
+    // Names which lookupTypes and lookupLocalIdentifiers will look up.
+    std::vector<std::pair<FQName, Scope*>> lookups;
+    size_t generation = ConstantExpression::beginPass();
+
+    status_t err = mRootScope.recursivePass([&](Type* type) -> status_t {
+        Scope* scope = type->isScope() ? static_cast<Scope*>(type) : type->parent();
+
+        status_t err = type->forEachReference([&](Reference<Type>* nextRef) {
+            if (!nextRef->isResolved()) {
+                lookups.emplace_back(nextRef->getLookupFqName(), scope);
+            }
+            return OK;
+        });
+        if (err != OK) return err;
+
+        return type->forEachConstantExpression([&](ConstantExpression* ce) {
+            return ce->recursivePass(
+                [&](ConstantExpression* ce) {
+                    return ce->forEachReference([&](const Reference<LocalIdentifier>* ref) {
+                        const FQName& fqName = ref->getLookupFqName();
+                        if (!ref->isResolved() && !fqName.isIdentifier()) {
+                            lookups.emplace_back(fqName.typeName(), scope);
+                        }
+                        return OK;
+                    });
+                },
+                generation, true /* processBeforeDependencies */);
+        });
+    });
+    if (err != OK) return err;
+
+    for (const auto& lookup : lookups) {
+        const FQName& fqName = lookup.first;
+        if (fqName.name().empty()) continue;
+
+        FQName autofilled = fqName;
+        autofilled.applyDefaults(mPackage.package(), mPackage.version());
+        if (!parseLazilyImportedFiles(autofilled)) return UNKNOWN_ERROR;
+
+        // Same order as lookupType, so that whole packages are only parsed
+        // for names which aren't defined in this package or in the files
+        // already imported (e.x. types.hal).
+        if (fqName.package().empty() && fqName.version().empty() &&
+            lookupTypeLocally(fqName, lookup.second) != nullptr) {
+            continue;
+        }
+        Type* type = nullptr;
+        if (lookupAutofilledType(fqName, &type) != OK) return UNKNOWN_ERROR;
+        if (type != nullptr) continue;
+
+        if (!parseLazilyImportedFiles(fqName)) return UNKNOWN_ERROR;
+    }
+
+    return OK;
 }
 
 status_t AST::gatherReferencedTypes() {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(
-        [&](Type* type) -> status_t {
-            for (auto* nextRef : type->getReferences()) {
-                const Type *targetType = nextRef->get();
-                if (targetType->isNamedType()) {
-                    mReferencedTypeNames.insert(
-                            static_cast<const NamedType *>(targetType)->fqName());
-                }
+    return mRootScope.recursivePass([&](Type* type) -> status_t {
+        return type->forEachReference([&](Reference<Type>* nextRef) {
+            const Type *targetType = nextRef->get();
+            if (targetType->isNamedType()) {
+                mReferencedTypeNames.insert(
+                        static_cast<const NamedType *>(targetType)->fqName());
             }
 
             return OK;
-        },
-        &visited);
+        });
+    });
 }
 
 status_t AST::lookupLocalIdentifiers() {
-    std::unordered_set<const Type*> visitedTypes;
-    std::unordered_set<const ConstantExpression*> visitedCE;
+    size_t generation = ConstantExpression::beginPass();
 
-    return mRootScope.recursivePass(
-        [&](Type* type) -> status_t {
-            Scope* scope = type->isScope() ? static_cast<Scope*>(type) : type->parent();
+    return mRootScope.recursivePass([&](Type* type) -> status_t {
+        Scope* scope = type->isScope() ? static_cast<Scope*>(type) : type->parent();
 
-            for (auto* ce : type->getConstantExpressions()) {
-                status_t err = ce->recursivePass(
-                    [&](ConstantExpression* ce) {
-                        for (auto* nextRef : ce->getReferences()) {
-                            if (nextRef->isResolved()) continue;
+        return type->forEachConstantExpression([&](ConstantExpression* ce) {
+            return ce->recursivePass(
+                [&](ConstantExpression* ce) {
+                    return ce->forEachReference([&](const Reference<LocalIdentifier>* ref) {
+                        if (ref->isResolved()) return OK;
 
-                            LocalIdentifier* iden = lookupLocalIdentifier(*nextRef, scope);
-                            if (iden == nullptr) return UNKNOWN_ERROR;
-                            nextRef->set(iden);
-                        }
+                        auto* nextRef = const_cast<Reference<LocalIdentifier>*>(ref);
+                        LocalIdentifier* iden = lookupLocalIdentifier(*nextRef, scope);
+                        if (iden == nullptr) return UNKNOWN_ERROR;
+                        nextRef->set(iden);
                         return OK;
-                    },
-                    &visitedCE, true /* processBeforeDependencies */);
-                if (err != OK) return err;
-            }
-
-            return OK;
-        },
-        &visitedTypes);
+                    });
+                },
+                generation, true /* processBeforeDependencies */);
+        });
+    });
 }
 
 status_t AST::validateDefinedTypesUniqueNames() const {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(
-        [&](const Type* type) -> status_t {
-            // We only want to validate type definition names in this place.
-            if (type->isScope()) {
-                return static_cast<const Scope*>(type)->validateUniqueNames();
-            }
-            return OK;
-        },
-        &visited);
+    return mRootScope.recursivePass([&](const Type* type) -> status_t {
+        // We only want to validate type definition names in this place.
+        if (type->isScope()) {
+            return static_cast<const Scope*>(type)->validateUniqueNames();
+        }
+        return OK;
+    });
 }
 
 status_t AST::resolveInheritance() {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(&Type::resolveInheritance, &visited);
+    return mRootScope.recursivePass(&Type::resolveInheritance);
 }
 
 status_t AST::evaluate() {
@@ -253,8 +297,7 @@ status_t AST::evaluate() {
 }
 
 status_t AST::validate() const {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(&Type::validate, &visited);
+    return mRootScope.recursivePass(&Type::validate);
 }
 
 status_t AST::topologicalReorder() {
@@ -263,45 +306,33 @@ status_t AST::topologicalReorder() {
     status_t err = mRootScope.topologicalOrder(&reversedOrder, &stack).status;
     if (err != OK) return err;
 
-    std::unordered_set<const Type*> visited;
-    mRootScope.recursivePass(
-        [&](Type* type) {
-            if (type->isScope()) {
-                static_cast<Scope*>(type)->topologicalReorder(reversedOrder);
-            }
-            return OK;
-        },
-        &visited);
+    mRootScope.recursivePass([&](Type* type) {
+        if (type->isScope()) {
+            static_cast<Scope*>(type)->topologicalReorder(reversedOrder);
+        }
+        return OK;
+    });
     return OK;
 }
 
 status_t AST::checkAcyclicConstantExpressions() const {
-    std::unordered_set<const Type*> visitedTypes;
     std::unordered_set<const ConstantExpression*> visitedCE;
     std::unordered_set<const ConstantExpression*> stack;
-    return mRootScope.recursivePass(
-        [&](const Type* type) -> status_t {
-            for (auto* ce : type->getConstantExpressions()) {
-                status_t err = ce->checkAcyclic(&visitedCE, &stack).status;
-                CHECK(err != OK || stack.empty());
-                if (err != OK) return err;
-            }
-            return OK;
-        },
-        &visitedTypes);
+    return mRootScope.recursivePass([&](const Type* type) -> status_t {
+        return type->forEachConstantExpression([&](const ConstantExpression* ce) {
+            status_t err = ce->checkAcyclic(&visitedCE, &stack).status;
+            CHECK(err != OK || stack.empty());
+            return err;
+        });
+    });
 }
 
 status_t AST::checkForwardReferenceRestrictions() const {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(
-        [](const Type* type) -> status_t {
-            for (const Reference<Type>* ref : type->getReferences()) {
-                status_t err = type->checkForwardReferenceRestrictions(*ref);
-                if (err != OK) return err;
-            }
-            return OK;
-        },
-        &visited);
+    return mRootScope.recursivePass([](const Type* type) -> status_t {
+        return type->forEachReference([&](const Reference<Type>* ref) {
+            return type->checkForwardReferenceRestrictions(*ref);
+        });
+    });
 }
 
 bool AST::addImport(const char *import) {
@@ -328,16 +359,12 @@ bool AST::addImport(const char *import) {
 
         for (const auto &subFQName : packageInterfaces) {
             addToImportedNamesGranular(subFQName);
-
-            // Do not enforce restrictions on imports.
-            AST* ast = mCoordinator->parse(subFQName, &mImportedASTs, Coordinator::Enforce::NONE);
-            if (ast == nullptr) {
-                return false;
-            }
-            // all previous single type imports are ignored.
-            mImportedTypes.erase(ast);
         }
 
+        // The files of the package are parsed once a type is looked up in
+        // them, see parseLazilyImportedFiles.
+        mLazilyImportedPackages.insert(fqName);
+
         return true;
     }
 
@@ -550,49 +577,113 @@ status_t AST::lookupAutofilledType(const FQName &fqName, Type **returnedType) {
     return OK;
 }
 
+bool AST::parseLazilyImportedFiles(const FQName& fqName) {
+    // If fqName has a package or a version, its name is complete, and it can
+    // only be defined in the file of its top-level type or in types.hal.
+    // Otherwise, it may be a partial name of a type nested in any file.
+    const bool qualified = !fqName.package().empty() || !fqName.version().empty();
+
+    for (auto it = mLazilyImportedPackages.begin(); it != mLazilyImportedPackages.end();) {
+        const FQName package = *it;
+        std::vector<FQName> files;
+
+        if (qualified) {
+            ++it;
+            if (!FQName(package.package(), package.version(), fqName.name()).endsWith(fqName)) {
+                continue;
+            }
+            FQName topLevelName(package.package(), package.version(),
+                                fqName.getTopLevelType().name());
+            files = {topLevelName, topLevelName.getTypesForPackage()};
+        } else {
+            status_t err = mCoordinator->appendPackageInterfacesToVector(package, &files);
+            if (err != OK) {
+                return false;
+            }
+            it = mLazilyImportedPackages.erase(it);
+        }
+
+        for (const auto& file : files) {
+            // Do not enforce restrictions on imports.
+            AST* ast;
+            status_t err =
+                mCoordinator->parseOptional(file, &ast, &mImportedASTs, Coordinator::Enforce::NONE);
+            if (err != OK) {
+                return false;
+            }
+            if (ast != nullptr) {
+                // all single type imports are ignored.
+                mImportedTypes.erase(ast);
+            }
+        }
+    }
+
+    return true;
+}
+
+void AST::findImportedTypes(const FQName& fqName,
+                            std::map<AST*, std::pair<FQName, Type*>>* matches) const {
+    std::vector<Coordinator::DefinedType> candidates;
+    mCoordinator->lookupDefinedTypes(fqName, &candidates);
+
+    for (const auto& candidate : candidates) {
+        if (mImportedASTs.find(candidate.ast) == mImportedASTs.end() ||
+            !candidate.fullName.endsWith(fqName)) {
+            continue;
+        }
+
+        // findDefinedType returns the first match in order of full names.
+        auto it = matches->find(candidate.ast);
+        if (it == matches->end() || candidate.fullName < it->second.first) {
+            (*matches)[candidate.ast] = {candidate.fullName, candidate.type};
+        }
+    }
+}
+
 // Rule 2: look at imports
 Type *AST::lookupTypeFromImports(const FQName &fqName) {
-
     Type *resolvedType = nullptr;
     Type *returnedType = nullptr;
     FQName resolvedName;
 
-    for (const auto &importedAST : mImportedASTs) {
-        if (mImportedTypes.find(importedAST) != mImportedTypes.end()) {
+    std::map<AST*, std::pair<FQName, Type*>> matches;
+    findImportedTypes(fqName, &matches);
+
+    for (const auto& pair : matches) {
+        if (mImportedTypes.find(pair.first) != mImportedTypes.end()) {
             // ignore single type imports
             continue;
         }
-        FQName matchingName;
-        Type *match = importedAST->findDefinedType(fqName, &matchingName);
+        const FQName& matchingName = pair.second.first;
+        Type* match = pair.second.second;
 
-        if (match != nullptr) {
-            if (resolvedType != nullptr) {
-                std::cerr << "ERROR: Unable to resolve type name '"
-                          << fqName.string()
-                          << "', multiple matches found:\n";
+        if (resolvedType != nullptr) {
+            std::cerr << "ERROR: Unable to resolve type name '"
+                      << fqName.string()
+                      << "', multiple matches found:\n";
 
-                std::cerr << "  " << resolvedName.string() << "\n";
-                std::cerr << "  " << matchingName.string() << "\n";
+            std::cerr << "  " << resolvedName.string() << "\n";
+            std::cerr << "  " << matchingName.string() << "\n";
 
-                return nullptr;
-            }
+            return nullptr;
+        }
 
-            resolvedType = match;
-            returnedType = resolvedType;
-            resolvedName = matchingName;
+        resolvedType = match;
+        returnedType = resolvedType;
+        resolvedName = matchingName;
 
-            // Keep going even after finding a match.
-        }
+        // Keep going even after finding a match.
     }
 
-    for (const auto &pair : mImportedTypes) {
-        AST *importedAST = pair.first;
-        std::set<Type *> importedTypes = pair.second;
+    for (const auto& pair : matches) {
+        auto importedTypes = mImportedTypes.find(pair.first);
+        if (importedTypes == mImportedTypes.end()) {
+            continue;
+        }
+        const FQName& matchingName = pair.second.first;
+        Type* match = pair.second.second;
 
-        FQName matchingName;
-        Type *match = importedAST->findDefinedType(fqName, &matchingName);
-        if (match != nullptr &&
-                importedTypes.find(match) != importedTypes.end()) {
+        if (importedTypes->second.find(match) != importedTypes->second.end()) {
             if (resolvedType != nullptr) {
                 std::cerr << "ERROR: Unable to resolve type name '"
                           << fqName.string()
@@ -640,10 +731,11 @@ Type *AST::lookupTypeFromImports(const FQName &fqName) {
 
         if (!resolvedType->isInterface()) {
             FQName ifc = resolvedName.getTopLevelType();
-            for (const auto &importedAST : mImportedASTs) {
-                FQName matchingName;
-                Type *match = importedAST->findDefinedType(ifc, &matchingName);
-                if (match != nullptr && match->isInterface()) {
+            std::map<AST*, std::pair<FQName, Type*>> ifcMatches;
+            findImportedTypes(ifc, &ifcMatches);
+            for (const auto& pair : ifcMatches) {
+                Type* match = pair.second.second;
+                if (match->isInterface()) {
                     resolvedType = match;
                 }
             }
@@ -708,6 +800,37 @@ void AST::getImportedPackages(std::set<FQName> *importSet) const {
     }
 }
 
+status_t AST::parseAllLazilyImportedFiles() {
+    std::set<AST*> visited;
+    return parseAllLazilyImportedFiles(&visited);
+}
+
+status_t AST::parseAllLazilyImportedFiles(std::set<AST*>* visited) {
+    if (!visited->insert(this).second) return OK;
+
+    for (const auto& package : mLazilyImportedPackages) {
+        std::vector<FQName> packageInterfaces;
+        status_t err = mCoordinator->appendPackageInterfacesToVector(package, &packageInterfaces);
+        if (err != OK) return err;
+
+        for (const auto& subFQName : packageInterfaces) {
+            // Do not enforce restrictions on imports.
+            AST* ast = mCoordinator->parse(subFQName, &mImportedASTs, Coordinator::Enforce::NONE);
+            if (ast == nullptr) return UNKNOWN_ERROR;
+            // all single type imports are ignored.
+            mImportedTypes.erase(ast);
+        }
+    }
+    mLazilyImportedPackages.clear();
+
+    for (AST* ast : mImportedASTs) {
+        status_t err = ast->parseAllLazilyImportedFiles(visited);
+        if (err != OK) return err;
+    }
+
+    return OK;
+}
+
 void AST::getImportedPackagesHierarchy(std::set<FQName> *importSet) const {
     getImportedPackages(importSet);
 
@@ -720,6 +843,14 @@ void AST::getImportedPackagesHierarchy(std::set<FQName> *importSet) const {
     importSet->insert(newSet.begin(), newSet.end());
 }
 
+void AST::getImportedFilesHierarchy(std::set<std::string>* files) const {
+    if (!files->insert(getFilename()).second) return;
+
+    for (const AST* ast : mImportedASTs) {
+        ast->getImportedFilesHierarchy(files);
+    }
+}
+
 void AST::getAllImportedNames(std::set<FQName> *allImportNames) const {
     for (const auto& name : mImportedNames) {
         allImportNames->insert(name);
@@ -778,6 +909,13 @@ void AST::addDefinedTypes(std::set<FQName> *definedTypes) const {
             });
 }
 
+void AST::forEachDefinedTypeByFullName(
+        const std::function<void(const FQName&, Type*)>& func) const {
+    for (const auto& pair : mDefinedTypesByFullName) {
+        func(pair.first, pair.second);
+    }
+}
+
 void AST::addReferencedTypes(std::set<FQName> *referencedTypes) const {
     std::for_each(
             mReferencedTypeNames.begin(),
@@ -27,6 +27,7 @@
 #include <string>
 #include <vector>
 
+#include "Arena.h"
 #include "Scope.h"
 #include "Type.h"
 
@@ -85,6 +86,11 @@ struct AST {
     status_t constantExpressionRecursivePass(
         const std::function<status_t(ConstantExpression*)>& func, bool processBeforeDependencies);
 
+    // Parses the files of mLazilyImportedPackages which the referenced
+    // types and enum values may be defined in, before the passes that
+    // look them up.
+    status_t parseLazilyImportedFiles();
+
     // Recursive tree pass that looks up all referenced types
     status_t lookupTypes();
 
@@ -133,6 +139,14 @@ struct AST {
     void generateCppAdapterHeader(Formatter& out) const;
     void generateCppAdapterSource(Formatter& out) const;
 
+    void generateCppFuzzerSource(Formatter& out) const;
+
+    void generateCppRecorderHeader(Formatter& out) const;
+    void generateCppRecorderSource(Formatter& out) const;
+    void generateCppReplayerSource(Formatter& out) const;
+
+    void generateCppBenchmarkSource(Formatter& out) const;
+
     void generateJava(Formatter& out, const std::string& limitToType) const;
     void generateJavaTypes(Formatter& out, const std::string& limitToType) const;
 
@@ -140,10 +154,20 @@ struct AST {
 
     void getImportedPackages(std::set<FQName> *importSet) const;
 
+    // Parses the files of mLazilyImportedPackages which weren't needed for
+    // lookups, here and in each AST imported, for the callers which need
+    // the whole import graph.
+    status_t parseAllLazilyImportedFiles();
+
     // Run getImportedPackages on this, then run getImportedPackages on
     // each AST in each package referenced in importSet.
+    // Requires parseAllLazilyImportedFiles.
     void getImportedPackagesHierarchy(std::set<FQName> *importSet) const;
 
+    // Adds the file of this AST and of every AST it imports, transitively.
+    // Whole packages which were imported but not looked up in aren't parsed.
+    void getImportedFilesHierarchy(std::set<std::string>* files) const;
+
     bool isJavaCompatible() const;
 
     // Warning: this only includes names explicitly referenced in code.
@@ -180,10 +204,15 @@ struct AST {
 
     Scope* getRootScope();
 
+    // Owns every node created while parsing this AST.
+    Arena* getArena();
+
     static void generateCppPackageInclude(Formatter& out, const FQName& package,
                                           const std::string& klass);
 
     void addDefinedTypes(std::set<FQName> *definedTypes) const;
+    void forEachDefinedTypeByFullName(
+        const std::function<void(const FQName&, Type*)>& func) const;
     void addReferencedTypes(std::set<FQName> *referencedTypes) const;
 
     void addToImportedNamesGranular(const FQName &fqName);
@@ -192,6 +221,9 @@ struct AST {
     const Coordinator* mCoordinator;
     const Hash* mFileHash;
 
+    // Declared before mRootScope so that the nodes it refers to outlive it.
+    Arena mArena;
+
     RootScope mRootScope;
 
     FQName mPackage;
@@ -217,6 +249,11 @@ struct AST {
     // mImportedTypes, then the whole AST is imported.
     std::map<AST *, std::set<Type *>> mImportedTypes;
 
+    // Packages imported as a whole, e.x. "import android.hardware.foo@1.0;",
+    // whose files are only parsed (and added to mImportedASTs) if a type may
+    // be looked up in them.
+    std::set<FQName> mLazilyImportedPackages;
+
     // Types keyed by full names defined in this AST.
     std::map<FQName, Type *> mDefinedTypesByFullName;
 
@@ -230,11 +267,23 @@ struct AST {
     status_t lookupAutofilledType(const FQName &fqName, Type **returnedType);
     Type *lookupTypeFromImports(const FQName &fqName);
 
+    // Parses the files of mLazilyImportedPackages which may define fqName.
+    // Returns false if one of them fails to parse.
+    bool parseLazilyImportedFiles(const FQName& fqName);
+
+    status_t parseAllLazilyImportedFiles(std::set<AST*>* visited);
+
     // Find a type matching fqName (which may be partial) and if found
     // return the associated type and fill in the full "matchingName".
     // Only types defined in this very AST are considered.
     Type *findDefinedType(const FQName &fqName, FQName *matchingName) const;
 
+    // Same as findDefinedType on each of mImportedASTs, keyed by the ASTs
+    // which define a match. Uses the coordinator's index of defined types
+    // rather than scanning every imported AST.
+    void findImportedTypes(const FQName& fqName,
+                           std::map<AST*, std::pair<FQName, Type*>>* matches) const;
+
     void getPackageComponents(std::vector<std::string> *components) const;
 
     void getPackageAndVersionComponents(
@@ -266,6 +315,13 @@ struct AST {
     void generateProxyMethodSource(Formatter& out, const std::string& className,
                                    const Method* method, const Interface* superInterface) const;
     void generateAdapterMethod(Formatter& out, const Method* method) const;
+    void generateCppFuzzerMethod(Formatter& out, const Method* method) const;
+    void generateCppRecorderMethod(Formatter& out, const std::string& className,
+                                   const Method* method, size_t index) const;
+    void generateCppReplayerReads(Formatter& out,
+                                  const std::vector<NamedReference<Type>*>& args) const;
+    void generateCppBenchmarkImplMethod(Formatter& out, const Method* method) const;
+    void generateCppBenchmarkMethod(Formatter& out, const Method* method) const;
 
     void generateFetchSymbol(Formatter &out, const std::string &ifaceName) const;
 
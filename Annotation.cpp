@@ -30,16 +30,9 @@ const std::string& AnnotationParam::getName() const {
     return mName;
 }
 
-std::vector<ConstantExpression*> AnnotationParam::getConstantExpressions() {
-    const auto& constRet = static_cast<const AnnotationParam*>(this)->getConstantExpressions();
-    std::vector<ConstantExpression*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ce) { return const_cast<ConstantExpression*>(ce); });
-    return ret;
-}
-
-std::vector<const ConstantExpression*> AnnotationParam::getConstantExpressions() const {
-    return {};
+status_t AnnotationParam::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>&) const {
+    return OK;
 }
 
 std::string AnnotationParam::getSingleString() const {
@@ -104,11 +97,13 @@ std::string ConstantExpressionAnnotationParam::getSingleValue() const {
     return convertToString(mValues->at(0));
 }
 
-std::vector<const ConstantExpression*> ConstantExpressionAnnotationParam::getConstantExpressions()
-    const {
-    std::vector<const ConstantExpression*> ret;
-    ret.insert(ret.end(), mValues->begin(), mValues->end());
-    return ret;
+status_t ConstantExpressionAnnotationParam::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>& func) const {
+    for (const auto* value : *mValues) {
+        status_t err = func(value);
+        if (err != OK) return err;
+    }
+    return OK;
 }
 
 Annotation::Annotation(const char* name, AnnotationParamVector* params)
@@ -132,21 +127,13 @@ const AnnotationParam *Annotation::getParam(const std::string &name) const {
     return nullptr;
 }
 
-std::vector<ConstantExpression*> Annotation::getConstantExpressions() {
-    const auto& constRet = static_cast<const Annotation*>(this)->getConstantExpressions();
-    std::vector<ConstantExpression*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ce) { return const_cast<ConstantExpression*>(ce); });
-    return ret;
-}
-
-std::vector<const ConstantExpression*> Annotation::getConstantExpressions() const {
-    std::vector<const ConstantExpression*> ret;
+status_t Annotation::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>& func) const {
     for (const auto* param : *mParams) {
-        const auto& retParam = param->getConstantExpressions();
-        ret.insert(ret.end(), retParam.begin(), retParam.end());
+        status_t err = param->forEachConstantExpression(func);
+        if (err != OK) return err;
     }
-    return ret;
+    return OK;
 }
 
 void Annotation::dump(Formatter &out) const {
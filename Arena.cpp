@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Arena.h"
+
+#include <android-base/logging.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace android {
+
+Arena::~Arena() {
+    for (auto it = mDestructors.rbegin(); it != mDestructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+}
+
+static char* alignUp(char* ptr, size_t alignment) {
+    uintptr_t value = reinterpret_cast<uintptr_t>(ptr);
+    return reinterpret_cast<char*>((value + alignment - 1) & ~(alignment - 1));
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    CHECK(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    mBytesAllocated += size;
+
+    // Oversized requests get a block of their own, so that the remainder of
+    // the current block is not wasted.
+    if (size + alignment > kBlockSize / 4) {
+        mBlocks.emplace_back(new char[size + alignment]);
+        return alignUp(mBlocks.back().get(), alignment);
+    }
+
+    if (mNext == nullptr || alignUp(mNext, alignment) + size > mEnd) {
+        mBlocks.emplace_back(new char[kBlockSize]);
+        mNext = mBlocks.back().get();
+        mEnd = mNext + kBlockSize;
+    }
+
+    char* ptr = alignUp(mNext, alignment);
+    mNext = ptr + size;
+    return ptr;
+}
+
+const char* Arena::intern(const char* str, size_t length) {
+    auto it = mInterned.find(std::string_view(str, length));
+    if (it != mInterned.end()) {
+        return it->data();
+    }
+
+    char* copy = static_cast<char*>(allocate(length + 1, alignof(char)));
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+
+    mInterned.insert(std::string_view(copy, length));
+    return copy;
+}
+
+const char* Arena::intern(const std::string& str) {
+    return intern(str.c_str(), str.size());
+}
+
+size_t Arena::bytesAllocated() const {
+    return mBytesAllocated;
+}
+
+}  // namespace android
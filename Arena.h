@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ARENA_H_
+
+#define ARENA_H_
+
+#include <android-base/macros.h>
+#include <stddef.h>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace android {
+
+// Bump allocator owning the front-end nodes (types, references, constant
+// expressions, methods, annotations, ...) created while parsing a file.
+// Nodes are never freed individually; they are all destroyed, in reverse
+// order of creation, when the arena is.
+struct Arena {
+    Arena() = default;
+    ~Arena();
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            mDestructors.push_back({object, [](void* p) { static_cast<T*>(p)->~T(); }});
+        }
+        return object;
+    }
+
+    // Takes ownership of a heap allocated node (e.x. from a factory function
+    // that predates the arena), so that it is deleted along with the arena.
+    template <typename T>
+    T* adopt(T* object) {
+        if (object != nullptr) {
+            mDestructors.push_back({object, [](void* p) { delete static_cast<T*>(p); }});
+        }
+        return object;
+    }
+
+    // Returns a null-terminated copy of str owned by the arena. Equal strings
+    // share the same copy.
+    const char* intern(const char* str, size_t length);
+    const char* intern(const std::string& str);
+
+    size_t bytesAllocated() const;
+
+   private:
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    struct Destructor {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    std::vector<std::unique_ptr<char[]>> mBlocks;
+    char* mNext = nullptr;
+    char* mEnd = nullptr;
+    size_t mBytesAllocated = 0;
+
+    std::vector<Destructor> mDestructors;
+    std::unordered_set<std::string_view> mInterned;
+
+    void* allocate(size_t size, size_t alignment);
+
+    DISALLOW_COPY_AND_ASSIGN(Arena);
+};
+
+}  // namespace android
+
+#endif  // ARENA_H_
@@ -57,14 +57,18 @@ std::string ArrayType::typeName() const {
     return std::to_string(dimension()) + "d array of " + mElementType->typeName();
 }
 
-std::vector<const Reference<Type>*> ArrayType::getReferences() const {
-    return {&mElementType};
+status_t ArrayType::forEachReference(
+    const std::function<status_t(const Reference<Type>*)>& func) const {
+    return func(&mElementType);
 }
 
-std::vector<const ConstantExpression*> ArrayType::getConstantExpressions() const {
-    std::vector<const ConstantExpression*> ret;
-    ret.insert(ret.end(), mSizes.begin(), mSizes.end());
-    return ret;
+status_t ArrayType::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>& func) const {
+    for (const auto* size : mSizes) {
+        status_t err = func(size);
+        if (err != OK) return err;
+    }
+    return OK;
 }
 
 status_t ArrayType::resolveInheritance() {
@@ -583,6 +587,44 @@ void ArrayType::emitVtsTypeDeclarations(Formatter& out) const {
     }
 }
 
+void ArrayType::emitCppConsumeValue(Formatter& out, const std::string& provider,
+                                    const std::string& name, size_t depth) const {
+    std::string elementName = name;
+    for (size_t dim = 0; dim < mSizes.size(); ++dim) {
+        const std::string iteratorName = "_hidl_index_" + std::to_string(depth + dim);
+        out << "for (size_t " << iteratorName << " = 0; " << iteratorName << " < "
+            << mSizes[dim]->cppValue() << "; ++" << iteratorName << ") {\n";
+        out.indent();
+        elementName += "[" + iteratorName + "]";
+    }
+
+    mElementType->emitCppConsumeValue(out, provider, elementName, depth + mSizes.size());
+
+    for (size_t dim = 0; dim < mSizes.size(); ++dim) {
+        out.unindent();
+        out << "}\n";
+    }
+}
+
+void ArrayType::emitCppLogValue(Formatter& out, const std::string& log, const std::string& name,
+                                bool isReader, size_t depth) const {
+    std::string elementName = name;
+    for (size_t dim = 0; dim < mSizes.size(); ++dim) {
+        const std::string iteratorName = "_hidl_index_" + std::to_string(depth + dim);
+        out << "for (size_t " << iteratorName << " = 0; " << iteratorName << " < "
+            << mSizes[dim]->cppValue() << "; ++" << iteratorName << ") {\n";
+        out.indent();
+        elementName += "[" + iteratorName + "]";
+    }
+
+    mElementType->emitCppLogValue(out, log, elementName, isReader, depth + mSizes.size());
+
+    for (size_t dim = 0; dim < mSizes.size(); ++dim) {
+        out.unindent();
+        out << "}\n";
+    }
+}
+
 bool ArrayType::deepIsJavaCompatible(std::unordered_set<const Type*>* visited) const {
     if (!mElementType->isJavaCompatible(visited)) {
         return false;
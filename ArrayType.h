@@ -40,9 +40,11 @@ struct ArrayType : public Type {
 
     std::string typeName() const override;
 
-    std::vector<const Reference<Type>*> getReferences() const override;
+    status_t forEachReference(
+        const std::function<status_t(const Reference<Type>*)>& func) const override;
 
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t forEachConstantExpression(
+        const std::function<status_t(const ConstantExpression*)>& func) const override;
 
     // Extends existing array by adding another dimension.
     status_t resolveInheritance() override;
@@ -131,6 +133,10 @@ struct ArrayType : public Type {
             bool isReader) const override;
 
     void emitVtsTypeDeclarations(Formatter& out) const override;
+    void emitCppConsumeValue(Formatter& out, const std::string& provider,
+                             const std::string& name, size_t depth) const override;
+    void emitCppLogValue(Formatter& out, const std::string& log, const std::string& name,
+                         bool isReader, size_t depth) const override;
 
     bool deepIsJavaCompatible(std::unordered_set<const Type*>* visited) const override;
     bool deepContainsPointer(std::unordered_set<const Type*>* visited) const override;
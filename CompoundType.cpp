@@ -38,10 +38,13 @@ void CompoundType::setFields(std::vector<NamedReference<Type>*>* fields) {
     mFields = fields;
 }
 
-std::vector<const Reference<Type>*> CompoundType::getReferences() const {
-    std::vector<const Reference<Type>*> ret;
-    ret.insert(ret.begin(), mFields->begin(), mFields->end());
-    return ret;
+status_t CompoundType::forEachReference(
+    const std::function<status_t(const Reference<Type>*)>& func) const {
+    for (const auto* field : *mFields) {
+        status_t err = func(field);
+        if (err != OK) return err;
+    }
+    return OK;
 }
 
 status_t CompoundType::validate() const {
@@ -1032,6 +1035,36 @@ void CompoundType::emitVtsAttributeType(Formatter& out) const {
     out << "predefined_type: \"" << fullName() << "\"\n";
 }
 
+void CompoundType::emitCppConsumeValue(Formatter& out, const std::string& provider,
+                                       const std::string& name, size_t depth) const {
+    // Only one field of a union may be set, and which one isn't recorded.
+    if (mStyle != STYLE_STRUCT) {
+        return;
+    }
+
+    for (const auto& field : *mFields) {
+        field->type().emitCppConsumeValue(out, provider, name + "." + field->name(), depth);
+    }
+}
+
+void CompoundType::emitCppLogValue(Formatter& out, const std::string& log,
+                                   const std::string& name, bool isReader, size_t depth) const {
+    // Without embedded buffers, the layout (see getAlignmentAndSize) is the
+    // same in every process and can be copied as it is.
+    if (!needsEmbeddedReadWrite() && !containsInterface()) {
+        emitCppLogValueRaw(out, log, name, isReader);
+        return;
+    }
+
+    if (mStyle != STYLE_STRUCT) {
+        return;
+    }
+
+    for (const auto& field : *mFields) {
+        field->type().emitCppLogValue(out, log, name + "." + field->name(), isReader, depth);
+    }
+}
+
 bool CompoundType::deepIsJavaCompatible(std::unordered_set<const Type*>* visited) const {
     if (mStyle != STYLE_STRUCT) {
         return false;
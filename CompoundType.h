@@ -44,7 +44,8 @@ struct CompoundType : public Scope {
 
     std::string typeName() const override;
 
-    std::vector<const Reference<Type>*> getReferences() const override;
+    status_t forEachReference(
+        const std::function<status_t(const Reference<Type>*)>& func) const override;
 
     status_t validate() const override;
     status_t validateUniqueNames() const;
@@ -132,6 +133,10 @@ struct CompoundType : public Scope {
 
     void emitVtsTypeDeclarations(Formatter& out) const override;
     void emitVtsAttributeType(Formatter& out) const override;
+    void emitCppConsumeValue(Formatter& out, const std::string& provider,
+                             const std::string& name, size_t depth) const override;
+    void emitCppLogValue(Formatter& out, const std::string& log, const std::string& name,
+                         bool isReader, size_t depth) const override;
 
     bool deepIsJavaCompatible(std::unordered_set<const Type*>* visited) const override;
     bool deepContainsPointer(std::unordered_set<const Type*>* visited) const override;
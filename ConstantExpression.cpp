@@ -175,6 +175,7 @@ LiteralConstantExpression::LiteralConstantExpression(
     CHECK(isSupported(kind));
     mTrivialDescription = true;
     mExpr = expr;
+    mIsDescriptionFormatted = true;
     mValueKind = kind;
     mValue = value;
     mIsEvaluated = true;
@@ -254,7 +255,6 @@ void UnaryConstantExpression::evaluate() {
     CHECK(mUnary->isEvaluated());
     mIsEvaluated = true;
 
-    mExpr = std::string("(") + mOp + mUnary->description() + ")";
     mValueKind = mUnary->mValueKind;
 
 #define CASE_UNARY(__type__)                                          \
@@ -270,8 +270,6 @@ void BinaryConstantExpression::evaluate() {
     CHECK(mRval->isEvaluated());
     mIsEvaluated = true;
 
-    mExpr = std::string("(") + mLval->description() + " " + mOp + " " + mRval->description() + ")";
-
     bool isArithmeticOrBitflip = OP_IS_BIN_ARITHMETIC || OP_IS_BIN_BITFLIP;
 
     // CASE 1: + - *  / % | ^ & < > <= >= == !=
@@ -330,9 +328,6 @@ void TernaryConstantExpression::evaluate() {
     CHECK(mFalseVal->isEvaluated());
     mIsEvaluated = true;
 
-    mExpr = std::string("(") + mCond->description() + "?" + mTrueVal->description() + ":" +
-            mFalseVal->description() + ")";
-
     // note: for ?:, unlike arithmetic ops, integral promotion is not processed.
     mValueKind = usualArithmeticConversion(mTrueVal->mValueKind, mFalseVal->mValueKind);
 
@@ -356,17 +351,56 @@ void ReferenceConstantExpression::evaluate() {
     mIsEvaluated = true;
 }
 
-std::unique_ptr<ConstantExpression> ConstantExpression::addOne(ScalarType::Kind baseKind) {
-    auto ret = std::make_unique<BinaryConstantExpression>(
-        this, "+", ConstantExpression::One(baseKind).release());
-    return ret;
+void AutofillConstantExpression::evaluate() {
+    if (isEvaluated()) return;
+    CHECK(mReference->constExpr() != nullptr);
+
+    ConstantExpression* prev = mReference->constExpr();
+    CHECK(prev->isEvaluated());
+    mIsEvaluated = true;
+
+    // Same as BinaryConstantExpression for "prev + 1", with 1 of mBaseKind.
+    mValueKind = usualArithmeticConversion(integralPromotion(prev->mValueKind),
+                                           integralPromotion(mBaseKind));
+
+#define CASE_AUTOFILL(__type__)                                                       \
+    mValue = handleBinaryCommon(static_cast<__type__>(prev->mValue), std::string("+"), \
+                                static_cast<__type__>(1));                            \
+    return;
+
+    SWITCH_KIND(mValueKind, CASE_AUTOFILL, SHOULD_NOT_REACH(); return;)
 }
 
 const std::string& ConstantExpression::description() const {
     CHECK(isEvaluated());
+    if (!mIsDescriptionFormatted) {
+        mExpr = formatDescription();
+        mIsDescriptionFormatted = true;
+    }
+    return mExpr;
+}
+
+std::string ConstantExpression::formatDescription() const {
     return mExpr;
 }
 
+std::string UnaryConstantExpression::formatDescription() const {
+    return std::string("(") + mOp + mUnary->description() + ")";
+}
+
+std::string BinaryConstantExpression::formatDescription() const {
+    return std::string("(") + mLval->description() + " " + mOp + " " + mRval->description() + ")";
+}
+
+std::string TernaryConstantExpression::formatDescription() const {
+    return std::string("(") + mCond->description() + "?" + mTrueVal->description() + ":" +
+           mFalseVal->description() + ")";
+}
+
+std::string AutofillConstantExpression::formatDescription() const {
+    return std::string("(") + mExpr + " + 1)";
+}
+
 bool ConstantExpression::descriptionIsTrivial() const {
     CHECK(isEvaluated());
     return mTrivialDescription;
@@ -456,50 +490,38 @@ bool ConstantExpression::isReferenceConstantExpression() const {
     return false;
 }
 
-std::vector<ConstantExpression*> ConstantExpression::getConstantExpressions() {
-    const auto& constRet = static_cast<const ConstantExpression*>(this)->getConstantExpressions();
-    std::vector<ConstantExpression*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ce) { return const_cast<ConstantExpression*>(ce); });
-    return ret;
-}
-
-std::vector<Reference<LocalIdentifier>*> ConstantExpression::getReferences() {
-    const auto& constRet = static_cast<const ConstantExpression*>(this)->getReferences();
-    std::vector<Reference<LocalIdentifier>*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ce) { return const_cast<Reference<LocalIdentifier>*>(ce); });
-    return ret;
+status_t ConstantExpression::forEachReference(
+    const std::function<status_t(const Reference<LocalIdentifier>*)>&) const {
+    return OK;
 }
 
-std::vector<const Reference<LocalIdentifier>*> ConstantExpression::getReferences() const {
-    return {};
+size_t ConstantExpression::beginPass() {
+    return PassMark::newGeneration();
 }
 
 status_t ConstantExpression::recursivePass(const std::function<status_t(ConstantExpression*)>& func,
-                                           std::unordered_set<const ConstantExpression*>* visited,
-                                           bool processBeforeDependencies) {
+                                           size_t generation, bool processBeforeDependencies) {
     if (mIsPostParseCompleted) return OK;
 
-    if (visited->find(this) != visited->end()) return OK;
-    visited->insert(this);
+    if (!mVisited.visit(generation)) return OK;
 
     if (processBeforeDependencies) {
         status_t err = func(this);
         if (err != OK) return err;
     }
 
-    for (auto* nextCE : getConstantExpressions()) {
-        status_t err = nextCE->recursivePass(func, visited, processBeforeDependencies);
-        if (err != OK) return err;
-    }
+    status_t err = forEachConstantExpression([&](const ConstantExpression* nextCE) {
+        return const_cast<ConstantExpression*>(nextCE)->recursivePass(func, generation,
+                                                                      processBeforeDependencies);
+    });
+    if (err != OK) return err;
 
-    for (auto* nextRef : getReferences()) {
+    err = forEachReference([&](const Reference<LocalIdentifier>* nextRef) {
         auto* nextCE = nextRef->shallowGet()->constExpr();
         CHECK(nextCE != nullptr) << "Local identifier is not a constant expression";
-        status_t err = nextCE->recursivePass(func, visited, processBeforeDependencies);
-        if (err != OK) return err;
-    }
+        return nextCE->recursivePass(func, generation, processBeforeDependencies);
+    });
+    if (err != OK) return err;
 
     if (!processBeforeDependencies) {
         status_t err = func(this);
@@ -510,29 +532,28 @@ status_t ConstantExpression::recursivePass(const std::function<status_t(Constant
 }
 
 status_t ConstantExpression::recursivePass(
-    const std::function<status_t(const ConstantExpression*)>& func,
-    std::unordered_set<const ConstantExpression*>* visited, bool processBeforeDependencies) const {
+    const std::function<status_t(const ConstantExpression*)>& func, size_t generation,
+    bool processBeforeDependencies) const {
     if (mIsPostParseCompleted) return OK;
 
-    if (visited->find(this) != visited->end()) return OK;
-    visited->insert(this);
+    if (!mVisited.visit(generation)) return OK;
 
     if (processBeforeDependencies) {
         status_t err = func(this);
         if (err != OK) return err;
     }
 
-    for (const auto* nextCE : getConstantExpressions()) {
-        status_t err = nextCE->recursivePass(func, visited, processBeforeDependencies);
-        if (err != OK) return err;
-    }
+    status_t err = forEachConstantExpression([&](const ConstantExpression* nextCE) {
+        return nextCE->recursivePass(func, generation, processBeforeDependencies);
+    });
+    if (err != OK) return err;
 
-    for (const auto* nextRef : getReferences()) {
+    err = forEachReference([&](const Reference<LocalIdentifier>* nextRef) {
         const auto* nextCE = nextRef->shallowGet()->constExpr();
         CHECK(nextCE != nullptr) << "Local identifier is not a constant expression";
-        status_t err = nextCE->recursivePass(func, visited, processBeforeDependencies);
-        if (err != OK) return err;
-    }
+        return nextCE->recursivePass(func, generation, processBeforeDependencies);
+    });
+    if (err != OK) return err;
 
     if (!processBeforeDependencies) {
         status_t err = func(this);
@@ -566,20 +587,25 @@ ConstantExpression::CheckAcyclicStatus ConstantExpression::checkAcyclic(
     visited->insert(this);
     stack->insert(this);
 
-    for (const auto* nextCE : getConstantExpressions()) {
-        auto err = nextCE->checkAcyclic(visited, stack);
-        if (err.status != OK) {
-            return err;
-        }
-    }
+    // Status to return if a cycle is found while visiting dependencies.
+    CheckAcyclicStatus ret(OK);
 
-    for (const auto* nextRef : getReferences()) {
+    forEachConstantExpression([&](const ConstantExpression* nextCE) {
+        ret = nextCE->checkAcyclic(visited, stack);
+        return ret.status;
+    });
+    if (ret.status != OK) return ret;
+
+    forEachReference([&](const Reference<LocalIdentifier>* nextRef) -> status_t {
         const auto* nextCE = nextRef->shallowGet()->constExpr();
         CHECK(nextCE != nullptr) << "Local identifier is not a constant expression";
         auto err = nextCE->checkAcyclic(visited, stack);
 
         if (err.status != OK) {
-            if (err.cycleEnd == nullptr) return err;
+            if (err.cycleEnd == nullptr) {
+                ret = err;
+                return err.status;
+            }
 
             // Only ReferenceConstantExpression has references,
             CHECK(isReferenceConstantExpression())
@@ -590,12 +616,15 @@ ConstantExpression::CheckAcyclicStatus ConstantExpression::checkAcyclic(
                       << nextRef->location() << "\n";
 
             if (err.cycleEnd == this) {
-                return CheckAcyclicStatus(err.status);
+                ret = CheckAcyclicStatus(err.status);
+            } else {
+                ret = CheckAcyclicStatus(err.status, err.cycleEnd,
+                                         static_cast<const ReferenceConstantExpression*>(this));
             }
-            return CheckAcyclicStatus(err.status, err.cycleEnd,
-                                      static_cast<const ReferenceConstantExpression*>(this));
         }
-    }
+        return err.status;
+    });
+    if (ret.status != OK) return ret;
 
     CHECK(stack->find(this) != stack->end());
     stack->erase(this);
@@ -607,23 +636,28 @@ void ConstantExpression::setPostParseCompleted() {
     mIsPostParseCompleted = true;
 }
 
-std::vector<const ConstantExpression*> LiteralConstantExpression::getConstantExpressions() const {
-    return {};
+status_t LiteralConstantExpression::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>&) const {
+    return OK;
 }
 
 UnaryConstantExpression::UnaryConstantExpression(const std::string& op, ConstantExpression* value)
     : mUnary(value), mOp(op) {}
 
-std::vector<const ConstantExpression*> UnaryConstantExpression::getConstantExpressions() const {
-    return {mUnary};
+status_t UnaryConstantExpression::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>& func) const {
+    return func(mUnary);
 }
 
 BinaryConstantExpression::BinaryConstantExpression(ConstantExpression* lval, const std::string& op,
                                                    ConstantExpression* rval)
     : mLval(lval), mRval(rval), mOp(op) {}
 
-std::vector<const ConstantExpression*> BinaryConstantExpression::getConstantExpressions() const {
-    return {mLval, mRval};
+status_t BinaryConstantExpression::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>& func) const {
+    status_t err = func(mLval);
+    if (err != OK) return err;
+    return func(mRval);
 }
 
 TernaryConstantExpression::TernaryConstantExpression(ConstantExpression* cond,
@@ -631,8 +665,13 @@ TernaryConstantExpression::TernaryConstantExpression(ConstantExpression* cond,
                                                      ConstantExpression* falseVal)
     : mCond(cond), mTrueVal(trueVal), mFalseVal(falseVal) {}
 
-std::vector<const ConstantExpression*> TernaryConstantExpression::getConstantExpressions() const {
-    return {mCond, mTrueVal, mFalseVal};
+status_t TernaryConstantExpression::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>& func) const {
+    status_t err = func(mCond);
+    if (err != OK) return err;
+    err = func(mTrueVal);
+    if (err != OK) return err;
+    return func(mFalseVal);
 }
 
 ReferenceConstantExpression::ReferenceConstantExpression(const Reference<LocalIdentifier>& value,
@@ -640,19 +679,32 @@ ReferenceConstantExpression::ReferenceConstantExpression(const Reference<LocalId
     : mReference(value) {
     mExpr = expr;
     mTrivialDescription = mExpr.empty();
+    mIsDescriptionFormatted = true;
+}
+
+AutofillConstantExpression::AutofillConstantExpression(const EnumType* prevType,
+                                                       EnumValue* prevValue,
+                                                       const Location& location,
+                                                       ScalarType::Kind baseKind)
+    : ReferenceConstantExpression(Reference<LocalIdentifier>(prevValue, location),
+                                  prevType->fullName() + "." + prevValue->name() + " implicitly"),
+      mBaseKind(baseKind) {
+    mIsDescriptionFormatted = false;
 }
 
 bool ReferenceConstantExpression::isReferenceConstantExpression() const {
     return true;
 }
 
-std::vector<const ConstantExpression*> ReferenceConstantExpression::getConstantExpressions() const {
-    // Returns reference instead
-    return {};
+status_t ReferenceConstantExpression::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>&) const {
+    // Visits reference instead
+    return OK;
 }
 
-std::vector<const Reference<LocalIdentifier>*> ReferenceConstantExpression::getReferences() const {
-    return {&mReference};
+status_t ReferenceConstantExpression::forEachReference(
+    const std::function<status_t(const Reference<LocalIdentifier>*)>& func) const {
+    return func(&mReference);
 }
 
 /*
@@ -25,11 +25,14 @@
 #include <unordered_set>
 #include <vector>
 
+#include "PassMark.h"
 #include "Reference.h"
 #include "ScalarType.h"
 
 namespace android {
 
+struct EnumType;
+struct EnumValue;
 struct LocalIdentifier;
 
 struct LiteralConstantExpression;
@@ -37,6 +40,7 @@ struct UnaryConstantExpression;
 struct BinaryConstantExpression;
 struct TernaryConstantExpression;
 struct ReferenceConstantExpression;
+struct AutofillConstantExpression;
 
 /**
  * A constant expression is represented by a tree.
@@ -50,25 +54,30 @@ struct ConstantExpression {
 
     virtual bool isReferenceConstantExpression() const;
 
+    // Starts a new recursive pass, returning its generation.
+    // Nodes visited by any recursivePass call with this generation are
+    // skipped by later calls with the same generation.
+    static size_t beginPass();
+
     // Proceeds recursive pass
     // Makes sure to visit each node only once
     // Used to provide lookup and lazy evaluation
     status_t recursivePass(const std::function<status_t(ConstantExpression*)>& func,
-                           std::unordered_set<const ConstantExpression*>* visited,
-                           bool processBeforeDependencies);
+                           size_t generation, bool processBeforeDependencies);
     status_t recursivePass(const std::function<status_t(const ConstantExpression*)>& func,
-                           std::unordered_set<const ConstantExpression*>* visited,
-                           bool processBeforeDependencies) const;
+                           size_t generation, bool processBeforeDependencies) const;
 
     // Evaluates current constant expression
     // Doesn't call recursive evaluation, so must be called after dependencies
     virtual void evaluate() = 0;
 
-    std::vector<ConstantExpression*> getConstantExpressions();
-    virtual std::vector<const ConstantExpression*> getConstantExpressions() const = 0;
+    // Calls func on each direct subexpression until one returns an error.
+    virtual status_t forEachConstantExpression(
+        const std::function<status_t(const ConstantExpression*)>& func) const = 0;
 
-    std::vector<Reference<LocalIdentifier>*> getReferences();
-    virtual std::vector<const Reference<LocalIdentifier>*> getReferences() const;
+    // Calls func on each referenced local identifier until one returns an error.
+    virtual status_t forEachReference(
+        const std::function<status_t(const Reference<LocalIdentifier>*)>& func) const;
 
     // Recursive tree pass checkAcyclic return type.
     // Stores cycle end for nice error messages.
@@ -105,12 +114,10 @@ struct ConstantExpression {
     std::string cppValue(ScalarType::Kind castKind) const;
     /* Evaluated result in a string form, with given contextual kind. */
     std::string javaValue(ScalarType::Kind castKind) const;
-    /* Formatted expression with type. */
+    /* Formatted expression with type, formatted on first use. */
     const std::string& description() const;
     /* See mTrivialDescription */
     bool descriptionIsTrivial() const;
-    /* Return a ConstantExpression that is 1 plus the original. */
-    std::unique_ptr<ConstantExpression> addOne(ScalarType::Kind baseKind);
 
     size_t castSizeT() const;
 
@@ -121,8 +128,13 @@ struct ConstantExpression {
    private:
     /* If the result value has been evaluated. */
     bool mIsEvaluated = false;
-    /* The formatted expression. */
-    std::string mExpr;
+    /*
+     * The expression as written for literals and references. Replaced by
+     * the formatted expression (see formatDescription) once description()
+     * is first called.
+     */
+    mutable std::string mExpr;
+    mutable bool mIsDescriptionFormatted = false;
     /* The kind of the result value. */
     ScalarType::Kind mValueKind;
     /* The stored result value. */
@@ -132,6 +144,11 @@ struct ConstantExpression {
 
     bool mIsPostParseCompleted = false;
 
+    PassMark mVisited;
+
+    /* Formats description() from mExpr and subexpressions. */
+    virtual std::string formatDescription() const;
+
     /*
      * Helper function for all cpp/javaValue methods.
      * Returns a plain string (without any prefixes or suffixes, just the
@@ -152,12 +169,14 @@ struct ConstantExpression {
     friend struct BinaryConstantExpression;
     friend struct TernaryConstantExpression;
     friend struct ReferenceConstantExpression;
+    friend struct AutofillConstantExpression;
 };
 
 struct LiteralConstantExpression : public ConstantExpression {
     LiteralConstantExpression(ScalarType::Kind kind, uint64_t value);
     void evaluate() override;
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t forEachConstantExpression(
+        const std::function<status_t(const ConstantExpression*)>& func) const override;
 
     static LiteralConstantExpression* tryParse(const std::string& value);
 
@@ -168,35 +187,44 @@ private:
 struct UnaryConstantExpression : public ConstantExpression {
     UnaryConstantExpression(const std::string& mOp, ConstantExpression* value);
     void evaluate() override;
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t forEachConstantExpression(
+        const std::function<status_t(const ConstantExpression*)>& func) const override;
 
    private:
     ConstantExpression* const mUnary;
     std::string mOp;
+
+    std::string formatDescription() const override;
 };
 
 struct BinaryConstantExpression : public ConstantExpression {
     BinaryConstantExpression(ConstantExpression* lval, const std::string& op,
                              ConstantExpression* rval);
     void evaluate() override;
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t forEachConstantExpression(
+        const std::function<status_t(const ConstantExpression*)>& func) const override;
 
    private:
     ConstantExpression* const mLval;
     ConstantExpression* const mRval;
     const std::string mOp;
+
+    std::string formatDescription() const override;
 };
 
 struct TernaryConstantExpression : public ConstantExpression {
     TernaryConstantExpression(ConstantExpression* cond, ConstantExpression* trueVal,
                               ConstantExpression* falseVal);
     void evaluate() override;
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t forEachConstantExpression(
+        const std::function<status_t(const ConstantExpression*)>& func) const override;
 
    private:
     ConstantExpression* const mCond;
     ConstantExpression* const mTrueVal;
     ConstantExpression* const mFalseVal;
+
+    std::string formatDescription() const override;
 };
 
 struct ReferenceConstantExpression : public ConstantExpression {
@@ -204,13 +232,30 @@ struct ReferenceConstantExpression : public ConstantExpression {
 
     bool isReferenceConstantExpression() const override;
     void evaluate() override;
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
-    std::vector<const Reference<LocalIdentifier>*> getReferences() const override;
+    status_t forEachConstantExpression(
+        const std::function<status_t(const ConstantExpression*)>& func) const override;
+    status_t forEachReference(
+        const std::function<status_t(const Reference<LocalIdentifier>*)>& func) const override;
 
-   private:
+   protected:
     Reference<LocalIdentifier> mReference;
 };
 
+// Value of an enum value which isn't given explicitly, i.e. the previous
+// value plus one. Equivalent to "prevValue + 1", but without allocating
+// nodes for the literal and the sum.
+struct AutofillConstantExpression : public ReferenceConstantExpression {
+    AutofillConstantExpression(const EnumType* prevType, EnumValue* prevValue,
+                               const Location& location, ScalarType::Kind baseKind);
+
+    void evaluate() override;
+
+   private:
+    const ScalarType::Kind mBaseKind;
+
+    std::string formatDescription() const override;
+};
+
 }  // namespace android
 
 #endif  // CONSTANT_EXPRESSION_H_
@@ -16,12 +16,19 @@
 
 #include "Coordinator.h"
 
+#include <ctype.h>
 #include <dirent.h>
+#include <dlfcn.h>
+#include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <deque>
 #include <iterator>
+#include <unordered_set>
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <hidl-hash/Hash.h>
 #include <hidl-util/StringHelper.h>
@@ -29,19 +36,21 @@
 
 #include "AST.h"
 #include "Interface.h"
+#include "OutputArchive.h"
 #include "hidl-gen_l.h"
 
 static bool existdir(const char *name) {
-    DIR *dir = opendir(name);
-    if (dir == NULL) {
-        return false;
-    }
-    closedir(dir);
-    return true;
+    struct stat sb;
+    return stat(name, &sb) == 0 && S_ISDIR(sb.st_mode);
 }
 
 namespace android {
 
+Coordinator::Coordinator() {}
+
+// Cached ASTs are not deleted, see mCache.
+Coordinator::~Coordinator() {}
+
 const std::string &Coordinator::getRootPath() const {
     return mRootPath;
 }
@@ -54,6 +63,22 @@ void Coordinator::setRootPath(const std::string &rootPath) {
     }
 }
 
+const std::string& Coordinator::getOutputPath() const {
+    return mOutputPath;
+}
+
+status_t Coordinator::setOutputArchive(const std::string& path) {
+    mOutputArchive = OutputArchive::Open(path);
+    return mOutputArchive != nullptr ? OK : UNKNOWN_ERROR;
+}
+
+status_t Coordinator::closeOutputArchive() {
+    if (mOutputArchive == nullptr) return OK;
+
+    onFileAccess(mOutputArchive->getPath(), "w");
+    return mOutputArchive->close();
+}
+
 void Coordinator::setOutputPath(const std::string& outputPath) {
     mOutputPath = outputPath;
 }
@@ -70,6 +95,13 @@ void Coordinator::setDepFile(const std::string& depFile) {
     mDepFile = depFile;
 }
 
+void Coordinator::setDepDir(const std::string& depDir) {
+    mDepDir = depDir;
+    if (!mDepDir.empty() && mDepDir.back() != '/') {
+        mDepDir += "/";
+    }
+}
+
 const std::string& Coordinator::getOwner() const {
     return mOwner;
 }
@@ -77,6 +109,11 @@ void Coordinator::setOwner(const std::string& owner) {
     mOwner = owner;
 }
 
+void Coordinator::setParseThreads(size_t threads) {
+    CHECK(threads > 0);
+    mParseThreads = threads;
+}
+
 status_t Coordinator::addPackagePath(const std::string& root, const std::string& path, std::string* error) {
     FQName package = FQName(root, "0.0", "");
     for (const PackageRoot &packageRoot : mPackageRoots) {
@@ -113,11 +150,30 @@ Formatter Coordinator::getFormatter(const FQName& fqName, Location location,
 
     onFileAccess(filepath, "w");
 
+    if (isTrackingDependencies()) {
+        std::lock_guard<std::mutex> lock(mParseMutex);
+        mCurrentOutput = &mOutputDependencies[filepath];
+    }
+
+    if (mOutputArchive != nullptr) {
+        FILE* file = mOutputArchive->openEntry(StringHelper::LTrim(filepath, mOutputPath));
+        if (file == nullptr) {
+            fprintf(stderr, "ERROR: could not add %s to archive %s.\n", filepath.c_str(),
+                    mOutputArchive->getPath().c_str());
+            return Formatter::invalid();
+        }
+        return Formatter(file);
+    }
+
     if (!Coordinator::MakeParentHierarchy(filepath)) {
         fprintf(stderr, "ERROR: could not make directories for %s.\n", filepath.c_str());
         return Formatter::invalid();
     }
 
+    // The output may be a hard link into the output cache (see
+    // HIDL_GEN_CACHE_DIR), which must not be written through.
+    unlink(filepath.c_str());
+
     FILE* file = fopen(filepath.c_str(), "w");
 
     if (file == nullptr) {
@@ -166,14 +222,21 @@ status_t Coordinator::getFilepath(const FQName& fqName, Location location,
     return OK;
 }
 
+bool Coordinator::isTrackingDependencies() const {
+    return !mDepFile.empty() || !mDepDir.empty();
+}
+
 void Coordinator::onFileAccess(const std::string& path, const std::string& mode) const {
-    if (mode == "r") {
+    if (mode == "r" && isTrackingDependencies()) {
         // This is a global list. It's not cleared when a second fqname is processed for
         // two reasons:
         // 1). If there is a bug in hidl-gen, the dependencies on the first project from
         //     the second would be required to recover correctly when the bug is fixed.
         // 2). This option is never used in Android builds.
-        mReadFiles.insert(StringHelper::LTrim(path, mRootPath));
+        std::lock_guard<std::mutex> lock(mParseMutex);
+        std::set<std::string>& readFiles =
+            mCurrentOutput != nullptr ? mCurrentOutput->readFiles : mReadFiles;
+        readFiles.insert(StringHelper::LTrim(path, mRootPath));
     }
 
     if (!mVerbose) {
@@ -184,23 +247,91 @@ void Coordinator::onFileAccess(const std::string& path, const std::string& mode)
             "VERBOSE: file access %s %s\n", path.c_str(), mode.c_str());
 }
 
-status_t Coordinator::writeDepFile(const std::string& forFile) const {
+void Coordinator::appendOutputDependencies(const std::string& outputFile,
+                                           std::set<std::string>* dependencies) const {
+    auto it = mOutputDependencies.find(outputFile);
+    if (it == mOutputDependencies.end()) return;
+
+    dependencies->insert(it->second.readFiles.begin(), it->second.readFiles.end());
+
+    std::set<std::string> astFiles;
+    for (const AST* ast : it->second.asts) {
+        ast->getImportedFilesHierarchy(&astFiles);
+    }
+    for (const std::string& file : astFiles) {
+        dependencies->insert(StringHelper::LTrim(file, mRootPath));
+    }
+}
+
+void Coordinator::addOutputDependencies(const std::vector<std::string>& outputFiles,
+                                        const std::vector<std::string>& inputs) const {
+    if (!isTrackingDependencies()) return;
+
+    std::lock_guard<std::mutex> lock(mParseMutex);
+    for (const std::string& outputFile : outputFiles) {
+        OutputDependencies& dependencies = mOutputDependencies[outputFile];
+        for (const std::string& input : inputs) {
+            dependencies.readFiles.insert(StringHelper::LTrim(input, mRootPath));
+        }
+    }
+    mCurrentOutput = nullptr;
+}
+
+status_t Coordinator::writeDepFile(const std::vector<std::string>& outputFiles) const {
     // No dep file requested
-    if (mDepFile.empty()) return OK;
+    if (!isTrackingDependencies() || outputFiles.empty()) return OK;
+
+    if (!mDepFile.empty()) {
+        // Depfiles in Android for genrules should be for the 'main file'. Because hidl-gen
+        // doesn't have a main file for most targets, all dependencies are listed for the
+        // first output.
+        std::set<std::string> dependencies = mReadFiles;
+        for (const std::string& outputFile : outputFiles) {
+            appendOutputDependencies(outputFile, &dependencies);
+        }
+
+        const std::string& forFile =
+            mOutputArchive != nullptr ? mOutputArchive->getPath() : outputFiles[0];
+        status_t err = writeDepFile(mDepFile, forFile, dependencies);
+        if (err != OK) return err;
+    }
 
-    onFileAccess(mDepFile, "w");
+    // Entries of an archive have no depfiles of their own.
+    if (!mDepDir.empty() && mOutputArchive == nullptr) {
+        for (const std::string& outputFile : outputFiles) {
+            std::set<std::string> dependencies = mReadFiles;
+            appendOutputDependencies(outputFile, &dependencies);
 
-    FILE* file = fopen(mDepFile.c_str(), "w");
+            const std::string depFile =
+                mDepDir + StringHelper::LTrim(outputFile, mOutputPath) + ".d";
+            if (!Coordinator::MakeParentHierarchy(depFile)) {
+                fprintf(stderr, "ERROR: could not make directories for %s.\n", depFile.c_str());
+                return UNKNOWN_ERROR;
+            }
+
+            status_t err = writeDepFile(depFile, outputFile, dependencies);
+            if (err != OK) return err;
+        }
+    }
+
+    return OK;
+}
+
+status_t Coordinator::writeDepFile(const std::string& depFile, const std::string& forFile,
+                                   const std::set<std::string>& dependencies) const {
+    onFileAccess(depFile, "w");
+
+    FILE* file = fopen(depFile.c_str(), "w");
     if (file == nullptr) {
-        fprintf(stderr, "ERROR: could not open dep file at %s.\n", mDepFile.c_str());
+        fprintf(stderr, "ERROR: could not open dep file at %s.\n", depFile.c_str());
         return UNKNOWN_ERROR;
     }
 
     Formatter out(file, 2 /* spacesPerIndent */);
     out << StringHelper::LTrim(forFile, mOutputPath) << ": \\\n";
     out.indent([&] {
-        for (const std::string& file : mReadFiles) {
-            out << StringHelper::LTrim(file, mRootPath) << " \\\n";
+        for (const std::string& file : dependencies) {
+            out << file << " \\\n";
         }
     });
     return OK;
@@ -212,35 +343,114 @@ AST* Coordinator::parse(const FQName& fqName, std::set<AST*>* parsedASTs,
     status_t err = parseOptional(fqName, &ret, parsedASTs, enforcement);
     if (err != OK) CHECK(ret == nullptr);  // internal consistency
 
+    if (ret != nullptr && isTrackingDependencies()) {
+        std::lock_guard<std::mutex> lock(mParseMutex);
+        if (mCurrentOutput != nullptr) mCurrentOutput->asts.insert(ret);
+    }
+
     // only in a handful of places do we want to distinguish between
     // a missing file and a bad AST. Everywhere else, we just want to
     // throw an error if we expect an AST to be present but it is not.
     return ret;
 }
 
+// Number of parseOptional calls in progress on this thread. Worker threads
+// of parseImportGraph start at 1, since they only parse imports.
+static thread_local size_t sParseDepth = 0;
+
 status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AST*>* parsedASTs,
                                     Enforce enforcement) const {
     CHECK(fqName.isFullyQualified());
 
-    auto it = mCache.find(fqName);
-    if (it != mCache.end()) {
-        *ast = (*it).second;
+    // The import graph of a file is scanned once, by the outermost parse,
+    // rather than again by the parse of each of its imports.
+    if (mParseThreads > 1 && sParseDepth == 0) {
+        prefetchImports(fqName);
+    }
 
-        if (*ast != nullptr && parsedASTs != nullptr) {
-            parsedASTs->insert(*ast);
+    sParseDepth++;
+    status_t err = lookupOrParse(fqName, ast, parsedASTs, enforcement);
+    sParseDepth--;
+    return err;
+}
+
+bool Coordinator::waitsForThisThread(std::thread::id owner) const {
+    const std::thread::id self = std::this_thread::get_id();
+    while (owner != self) {
+        auto waiting = mWaitingFor.find(owner);
+        if (waiting == mWaitingFor.end()) return false;
+        auto parsing = mParsing.find(waiting->second);
+        if (parsing == mParsing.end()) return false;
+        owner = parsing->second;
+    }
+    return true;
+}
+
+status_t Coordinator::lookupOrParse(const FQName& fqName, AST** ast, std::set<AST*>* parsedASTs,
+                                    Enforce enforcement) const {
+    bool cached = false;
+    {
+        std::unique_lock<std::mutex> lock(mParseMutex);
+
+        // While imports are prefetched, another thread may be parsing fqName.
+        // Wait for it rather than mistaking it for a circular import, unless
+        // that thread is itself waiting for a file this thread is parsing.
+        // Files imported lazily (see AST::parseLazilyImportedFiles) are not
+        // in the prefetched import graph, so such cycles are only found here.
+        const std::thread::id self = std::this_thread::get_id();
+        for (auto parsing = mParsing.find(fqName);
+             parsing != mParsing.end() && parsing->second != self;
+             parsing = mParsing.find(fqName)) {
+            if (waitsForThisThread(parsing->second)) {
+                // Same as the circular import below.
+                *ast = nullptr;
+                return UNKNOWN_ERROR;
+            }
+            mWaitingFor[self] = fqName;
+            mParseCondition.wait(lock);
+            mWaitingFor.erase(self);
         }
 
-        if (*ast == nullptr) {
-            // circular import OR that AST has errors in it
-            return UNKNOWN_ERROR;
+        auto it = mCache.find(fqName);
+        if (it != mCache.end()) {
+            cached = true;
+            *ast = (*it).second;
+
+            if (*ast != nullptr && parsedASTs != nullptr) {
+                parsedASTs->insert(*ast);
+            }
+
+            if (*ast == nullptr) {
+                // circular import OR that AST has errors in it
+                return UNKNOWN_ERROR;
+            }
+        } else {
+            // Add this to the cache immediately, so we can discover circular imports.
+            mCache[fqName] = nullptr;
+            mParsing[fqName] = self;
         }
+    }
 
-        return OK;
+    if (cached) {
+        // fqName may have been parsed as an import, without enforcement.
+        status_t err = enforceRestrictionsOnPackage(fqName, enforcement);
+        if (err != OK) *ast = nullptr;
+        return err;
     }
 
-    // Add this to the cache immediately, so we can discover circular imports.
-    mCache[fqName] = nullptr;
+    status_t err = parseUncached(fqName, ast, parsedASTs, enforcement);
+
+    {
+        std::lock_guard<std::mutex> lock(mParseMutex);
+        mParsing.erase(fqName);
+    }
+    mParseCondition.notify_all();
+
+    return err;
+}
 
+status_t Coordinator::parseUncached(const FQName& fqName, AST** ast, std::set<AST*>* parsedASTs,
+                                    Enforce enforcement) const {
     AST *typesAST = nullptr;
 
     if (fqName.name() != "types") {
@@ -260,7 +470,20 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
 
     const std::string path = makeAbsolute(packagePath + fqName.name() + ".hal");
 
-    *ast = new AST(this, &Hash::getHash(path));
+    // The file is read exactly once; both hashing and parsing use this copy.
+    std::string content;
+    if (!readFile(path, &content)) {
+        {
+            std::lock_guard<std::mutex> lock(mParseMutex);
+            mCache.erase(fqName);  // nullptr in cache is used to find circular imports
+        }
+        *ast = nullptr;
+        return OK;  // File does not exist, nullptr AST* == file doesn't exist.
+    }
+
+    onFileAccess(path, "r");
+
+    *ast = new AST(this, &Hash::getHash(path, content));
 
     if (typesAST != NULL) {
         // If types.hal for this AST's package existed, make it's defined
@@ -268,19 +491,7 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
         (*ast)->addImportedAST(typesAST);
     }
 
-    std::unique_ptr<FILE, std::function<void(FILE*)>> file(fopen(path.c_str(), "rb"), fclose);
-
-    if (file == nullptr) {
-        mCache.erase(fqName);  // nullptr in cache is used to find circular imports
-        delete *ast;
-        *ast = nullptr;
-        return OK;  // File does not exist, nullptr AST* == file doesn't exist.
-    }
-
-    onFileAccess(path, "r");
-
-    // parse file takes ownership of file
-    if (parseFile(*ast, std::move(file)) != OK || (*ast)->postParse() != OK) {
+    if (parseFile(*ast, &content) != OK || (*ast)->postParse() != OK) {
         delete *ast;
         *ast = nullptr;
         return UNKNOWN_ERROR;
@@ -342,12 +553,20 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
 
     // put it into the cache now, so that enforceRestrictionsOnPackage can
     // parse fqName.
-    mCache[fqName] = *ast;
+    {
+        std::lock_guard<std::mutex> lock(mParseMutex);
+        mCache[fqName] = *ast;
+        indexDefinedTypes(*ast);
+    }
 
     // For each .hal file that hidl-gen parses, the whole package will be checked.
     err = enforceRestrictionsOnPackage(fqName, enforcement);
     if (err != OK) {
-        mCache[fqName] = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mParseMutex);
+            mCache[fqName] = nullptr;
+            unindexDefinedTypes(*ast);
+        }
         delete *ast;
         *ast = nullptr;
         return err;
@@ -356,6 +575,406 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
     return OK;
 }
 
+static std::string lastNameComponent(const FQName& fqName) {
+    const std::string& name = fqName.name();
+    return name.substr(name.rfind('.') + 1);
+}
+
+void Coordinator::indexDefinedTypes(AST* ast) const {
+    ast->forEachDefinedTypeByFullName([&](const FQName& fullName, Type* type) {
+        mDefinedTypesByLocalName[lastNameComponent(fullName)].push_back({ast, fullName, type});
+    });
+}
+
+void Coordinator::unindexDefinedTypes(AST* ast) const {
+    ast->forEachDefinedTypeByFullName([&](const FQName& fullName, Type*) {
+        auto it = mDefinedTypesByLocalName.find(lastNameComponent(fullName));
+        if (it == mDefinedTypesByLocalName.end()) return;
+
+        std::vector<DefinedType>& definedTypes = it->second;
+        definedTypes.erase(std::remove_if(definedTypes.begin(), definedTypes.end(),
+                                          [&](const auto& d) { return d.ast == ast; }),
+                           definedTypes.end());
+    });
+}
+
+void Coordinator::lookupDefinedTypes(const FQName& fqName,
+                                     std::vector<DefinedType>* candidates) const {
+    std::lock_guard<std::mutex> lock(mParseMutex);
+
+    auto it = mDefinedTypesByLocalName.find(lastNameComponent(fqName));
+    if (it != mDefinedTypesByLocalName.end()) {
+        candidates->insert(candidates->end(), it->second.begin(), it->second.end());
+    }
+}
+
+bool Coordinator::readFile(const std::string& path, std::string* content) const {
+    {
+        std::lock_guard<std::mutex> lock(mParseMutex);
+        auto it = mScannedFiles.find(path);
+        if (it != mScannedFiles.end()) {
+            *content = std::move(it->second);
+            mScannedFiles.erase(it);
+            return true;
+        }
+    }
+
+    return base::ReadFileToString(path, content);
+}
+
+static void skipSpacesAndComments(const std::string& content, size_t* pos) {
+    while (*pos < content.size()) {
+        if (isspace(static_cast<unsigned char>(content[*pos]))) {
+            ++*pos;
+        } else if (content.compare(*pos, 2, "//") == 0) {
+            *pos = std::min(content.find('\n', *pos), content.size());
+        } else if (content.compare(*pos, 2, "/*") == 0) {
+            size_t end = content.find("*/", *pos + 2);
+            *pos = end == std::string::npos ? content.size() : end + 2;
+        } else {
+            break;
+        }
+    }
+}
+
+// Returns the next keyword, (fully-qualified) name or punctuation character,
+// or an empty string at the end of the content.
+static std::string nextToken(const std::string& content, size_t* pos) {
+    skipSpacesAndComments(content, pos);
+
+    size_t start = *pos;
+    while (*pos < content.size() &&
+           (isalnum(static_cast<unsigned char>(content[*pos])) ||
+            strchr("_.@:", content[*pos]) != nullptr)) {
+        ++*pos;
+    }
+    if (*pos == start && *pos < content.size()) {
+        ++*pos;
+    }
+
+    return content.substr(start, *pos - start);
+}
+
+// Appends the names in the import statements at the start of a .hal file.
+// Syntax errors are left to the parser; scanning just stops at them.
+static void scanImportStatements(const std::string& content, std::vector<std::string>* imports) {
+    size_t pos = 0;
+    if (nextToken(content, &pos) != "package") return;
+    nextToken(content, &pos);
+    if (nextToken(content, &pos) != ";") return;
+
+    while (nextToken(content, &pos) == "import") {
+        std::string import = nextToken(content, &pos);
+        if (nextToken(content, &pos) != ";") return;
+
+        imports->push_back(import);
+    }
+}
+
+status_t Coordinator::scanImports(const FQName& fqName, std::set<FQName>* imports) const {
+    std::string packagePath;
+    status_t err =
+        getPackagePath(fqName, false /* relative */, false /* sanitized */, &packagePath);
+    if (err != OK) return err;
+
+    const std::string path = makeAbsolute(packagePath + fqName.name() + ".hal");
+
+    std::string content;
+    if (!base::ReadFileToString(path, &content)) {
+        return NAME_NOT_FOUND;
+    }
+
+    appendImports(fqName, content, imports);
+
+    std::lock_guard<std::mutex> lock(mParseMutex);
+    mScannedFiles[path] = std::move(content);
+
+    return OK;
+}
+
+void Coordinator::appendImports(const FQName& fqName, const std::string& content,
+                                std::set<FQName>* imports) const {
+    if (fqName.name() != "types") {
+        imports->insert(fqName.getTypesForPackage());
+
+        // Any interface implicitly imports IBase. Over-approximating here
+        // (e.x. for a misnamed types.hal) only delays parsing of this file.
+        if (fqName.package() != gIBaseFqName.package()) {
+            imports->insert(gIBaseFqName);
+        }
+    }
+
+    std::vector<std::string> importStatements;
+    scanImportStatements(content, &importStatements);
+
+    // Same resolution as AST::addImport.
+    for (const std::string& import : importStatements) {
+        FQName importName;
+        if (!FQName::parse(import, &importName)) break;
+        importName.applyDefaults(fqName.package(), fqName.version());
+
+        if (importName.name().empty()) {
+            // Files of whole imported packages are only parsed once a type is
+            // looked up in them; most lookups end up in types.hal.
+            imports->insert(importName.getTypesForPackage());
+            continue;
+        }
+
+        // Either the interface or, if it doesn't exist, types.hal is imported.
+        imports->insert(importName.getTopLevelType());
+        imports->insert(importName.getTypesForPackage());
+    }
+
+    imports->erase(fqName);
+}
+
+void Coordinator::prefetch(const std::vector<FQName>& fqNames) const {
+    std::map<FQName, std::set<FQName>> imports;
+    scanImportGraph(fqNames, &imports);
+    parseImportGraph(imports);
+}
+
+void Coordinator::hashFiles(const std::vector<FQName>& fqNames) const {
+    std::vector<std::string> paths;
+    for (const FQName& fqName : fqNames) {
+        CHECK(fqName.isFullyQualified());
+
+        std::string packagePath;
+        status_t err =
+            getPackagePath(fqName, false /* relative */, false /* sanitized */, &packagePath);
+        if (err != OK) continue;  // reported when the file is parsed
+
+        // same path as parse() hashes
+        paths.push_back(makeAbsolute(packagePath + fqName.name() + ".hal"));
+    }
+
+    Hash::hashFiles(paths, mParseThreads);
+}
+
+static const struct timespec& modificationTime(const struct stat& st) {
+#ifdef __APPLE__
+    return st.st_mtimespec;
+#else
+    return st.st_mtim;
+#endif
+}
+
+// Paths of the hidl-gen executable and the libraries generating output.
+static std::set<std::string> getHidlGenBinaries() {
+    std::set<std::string> binaries = {base::GetExecutablePath()};
+
+    const void* symbols[] = {
+        reinterpret_cast<const void*>(&existdir),                // libhidl-gen-ast
+        reinterpret_cast<const void*>(&Location::inSameFile),    // libhidl-gen
+        reinterpret_cast<const void*>(&StringHelper::LTrim),     // libhidl-gen-utils
+        reinterpret_cast<const void*>(&Hash::sha256),            // libhidl-gen-hash
+    };
+    for (const void* symbol : symbols) {
+        Dl_info info;
+        if (dladdr(symbol, &info) != 0 && info.dli_fname != nullptr) {
+            binaries.insert(info.dli_fname);
+        }
+    }
+
+    return binaries;
+}
+
+status_t Coordinator::getOutputCacheKey(const FQName& fqName, const std::string& format,
+                                        std::string* key,
+                                        std::vector<std::string>* inputs) const {
+    inputs->clear();
+
+    // Everything the key is a hash of, one item per line.
+    std::string manifest;
+
+    // hidl-gen is identified by the size and modification time of its
+    // binaries, which unlike their content can be checked on every run.
+    for (const std::string& binary : getHidlGenBinaries()) {
+        struct stat st;
+        if (stat(binary.c_str(), &st) != 0) return -errno;
+        manifest += "hidl-gen " + binary + " " + std::to_string(st.st_size) + " " +
+                    std::to_string(modificationTime(st).tv_sec) + "." +
+                    std::to_string(modificationTime(st).tv_nsec) + "\n";
+    }
+    manifest += "format " + format + "\n";
+    manifest += "target " + fqName.string() + "\n";
+    manifest += "owner " + mOwner + "\n";
+    for (const PackageRoot& packageRoot : mPackageRoots) {
+        manifest += "root " + packageRoot.root.package() + ":" + packageRoot.path + "\n";
+    }
+
+    std::set<std::string> files;
+    std::set<FQName> packages;
+    std::vector<FQName> toVisit = {fqName.getPackageAndVersion()};
+    while (!toVisit.empty()) {
+        FQName package = toVisit.back();
+        toVisit.pop_back();
+        if (!packages.insert(package).second) continue;
+
+        std::vector<FQName> packageInterfaces;
+        status_t err = appendPackageInterfacesToVector(package, &packageInterfaces);
+        if (err != OK) return err;
+
+        std::string packagePath;
+        err = getPackagePath(package, false /* relative */, false /* sanitized */, &packagePath);
+        if (err != OK) return err;
+
+        for (const FQName& interface : packageInterfaces) {
+            const std::string path = makeAbsolute(packagePath + interface.name() + ".hal");
+
+            std::string content;
+            if (!readFile(path, &content)) return NAME_NOT_FOUND;
+
+            files.insert(path);
+            manifest += "file " + StringHelper::LTrim(path, mRootPath) + " " +
+                        Hash::hexString(Hash::sha256(content)) + "\n";
+
+            std::set<FQName> imports;
+            appendImports(interface, content, &imports);
+            for (const FQName& import : imports) {
+                toVisit.push_back(import.getPackageAndVersion());
+            }
+
+            // Unless it was parsed already, leave the file for parse().
+            std::lock_guard<std::mutex> lock(mParseMutex);
+            if (mCache.find(interface) == mCache.end()) {
+                mScannedFiles[path] = std::move(content);
+            }
+        }
+
+        const std::string testPackageMarker = makeAbsolute(packagePath + ".hidl_for_test");
+        if (access(testPackageMarker.c_str(), F_OK) == 0) {
+            files.insert(testPackageMarker);
+            manifest += "test " + package.string() + "\n";
+        }
+
+        if (package.getPackageMinorVersion() > 0) {
+            FQName prevPackage = package.downRev();
+            std::string prevPath;
+            err = getPackagePath(prevPackage, false /* relative */, false /* sanitized */,
+                                 &prevPath);
+            if (err == OK && existdir(makeAbsolute(prevPath).c_str())) {
+                toVisit.push_back(prevPackage);
+            }
+        }
+
+        std::string rootPath;
+        err = getPackageRootPath(package, &rootPath);
+        if (err != OK) return err;
+
+        const std::string hashPath = makeAbsolute(rootPath) + "/current.txt";
+        if (files.find(hashPath) == files.end()) {
+            std::string content;
+            if (base::ReadFileToString(hashPath, &content)) {
+                files.insert(hashPath);
+                manifest += "file " + StringHelper::LTrim(hashPath, mRootPath) + " " +
+                            Hash::hexString(Hash::sha256(content)) + "\n";
+            }
+        }
+    }
+
+    *key = Hash::hexString(Hash::sha256(manifest));
+    inputs->assign(files.begin(), files.end());
+    return OK;
+}
+
+void Coordinator::prefetchImports(const FQName& fqName) const {
+    std::map<FQName, std::set<FQName>> imports;
+    scanImportGraph({fqName}, &imports);
+
+    // fqName itself is parsed by the caller.
+    imports.erase(fqName);
+
+    parseImportGraph(imports);
+}
+
+void Coordinator::scanImportGraph(const std::vector<FQName>& roots,
+                                  std::map<FQName, std::set<FQName>>* imports) const {
+    std::vector<FQName> toScan = roots;
+    while (!toScan.empty()) {
+        FQName next = toScan.back();
+        toScan.pop_back();
+
+        if (imports->find(next) != imports->end()) continue;
+        {
+            std::lock_guard<std::mutex> lock(mParseMutex);
+            if (mCache.find(next) != mCache.end()) continue;
+        }
+
+        std::set<FQName> nextImports;
+        if (scanImports(next, &nextImports) != OK) {
+            continue;  // parse() reports it, if the file is needed at all.
+        }
+
+        toScan.insert(toScan.end(), nextImports.begin(), nextImports.end());
+        (*imports)[next] = std::move(nextImports);
+    }
+}
+
+void Coordinator::parseImportGraph(const std::map<FQName, std::set<FQName>>& imports) const {
+    std::map<FQName, size_t> pendingImports;
+    std::map<FQName, std::vector<FQName>> importedBy;
+    std::deque<FQName> ready;
+    for (const auto& pair : imports) {
+        size_t pending = 0;
+        for (const FQName& import : pair.second) {
+            if (imports.find(import) == imports.end()) continue;
+
+            importedBy[import].push_back(pair.first);
+            pending++;
+        }
+
+        pendingImports[pair.first] = pending;
+        if (pending == 0) ready.push_back(pair.first);
+    }
+
+    // Files on import cycles never become ready. They are left to the
+    // serial parse, which reports the cycle.
+    if (ready.empty()) return;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t running = 0;
+
+    auto worker = [&] {
+        // Files parsed here are imports, which don't prefetch their own.
+        sParseDepth = 1;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            condition.wait(lock, [&] { return !ready.empty() || running == 0; });
+            if (ready.empty()) return;
+
+            FQName next = ready.front();
+            ready.pop_front();
+            running++;
+
+            lock.unlock();
+            // Do not enforce restrictions on imports.
+            AST* ast = parse(next, nullptr /* parsedASTs */, Enforce::NONE);
+            lock.lock();
+
+            running--;
+            // If next has errors, the files importing it are left to the
+            // serial parse, which stops at the first error like it always does.
+            if (ast != nullptr) {
+                for (const FQName& importer : importedBy[next]) {
+                    if (--pendingImports[importer] == 0) ready.push_back(importer);
+                }
+            }
+            condition.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::min(mParseThreads, imports.size()); i++) {
+        threads.emplace_back(worker);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
 const Coordinator::PackageRoot* Coordinator::findPackageRoot(const FQName& fqName) const {
     CHECK(!fqName.package().empty());
 
@@ -450,22 +1069,51 @@ status_t Coordinator::getPackageInterfaceFiles(
     if (err != OK) return err;
 
     const std::string path = makeAbsolute(packagePath);
-    DIR* dir = opendir(path.c_str());
 
-    if (dir == NULL) {
+    err = readPackageDirectory(path, fileNames);
+    if (err != OK) {
         fprintf(stderr, "ERROR: Could not open package path %s for package %s:\n%s\n",
                 packagePath.c_str(), package.string().c_str(), path.c_str());
+        return err;
+    }
+
+    return OK;
+}
+
+// struct stat names its modification time differently on darwin.
+status_t Coordinator::readPackageDirectory(const std::string& path,
+                                           std::vector<std::string>* fileNames) const {
+    struct stat dirStat;
+    if (stat(path.c_str(), &dirStat) == -1) {
+        return -errno;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mPackageDirectoriesMutex);
+        auto it = mPackageDirectories.find(path);
+        if (it != mPackageDirectories.end() &&
+            it->second.mtime.tv_sec == modificationTime(dirStat).tv_sec &&
+            it->second.mtime.tv_nsec == modificationTime(dirStat).tv_nsec) {
+            *fileNames = it->second.fileNames;
+            return OK;
+        }
+    }
+
+    DIR* dir = opendir(path.c_str());
+    if (dir == NULL) {
         return -errno;
     }
 
+    std::vector<std::string> scanned;
     struct dirent *ent;
     while ((ent = readdir(dir)) != NULL) {
         // filesystems may not support d_type and return DT_UNKNOWN
         if (ent->d_type == DT_UNKNOWN) {
             struct stat sb;
-            const auto filename = packagePath + std::string(ent->d_name);
+            const auto filename = path + std::string(ent->d_name);
             if (stat(filename.c_str(), &sb) == -1) {
                 fprintf(stderr, "ERROR: Could not stat %s\n", filename.c_str());
+                closedir(dir);
                 return -errno;
             }
             if ((sb.st_mode & S_IFMT) != S_IFREG) {
@@ -484,13 +1132,13 @@ status_t Coordinator::getPackageInterfaceFiles(
             continue;
         }
 
-        fileNames->push_back(std::string(ent->d_name, d_namelen - suffix_len));
+        scanned.push_back(std::string(ent->d_name, d_namelen - suffix_len));
     }
 
     closedir(dir);
     dir = NULL;
 
-    std::sort(fileNames->begin(), fileNames->end(),
+    std::sort(scanned.begin(), scanned.end(),
               [](const std::string& lhs, const std::string& rhs) -> bool {
                   if (lhs == "types") {
                       return true;
@@ -501,6 +1149,11 @@ status_t Coordinator::getPackageInterfaceFiles(
                   return lhs < rhs;
               });
 
+    *fileNames = scanned;
+
+    std::lock_guard<std::mutex> lock(mPackageDirectoriesMutex);
+    mPackageDirectories[path] = {modificationTime(dirStat), std::move(scanned)};
+
     return OK;
 }
 
@@ -539,6 +1192,102 @@ status_t Coordinator::convertPackageRootToPath(const FQName& fqName, std::string
     return OK;
 }
 
+// e.x. "1.0"
+static bool isVersionDirectory(const char* name) {
+    const char* dot = strchr(name, '.');
+    if (dot == nullptr || dot == name || dot[1] == '\0') return false;
+
+    for (const char* c = name; *c != '\0'; c++) {
+        if (c != dot && !isdigit(static_cast<unsigned char>(*c))) return false;
+    }
+    return true;
+}
+
+status_t Coordinator::appendPackagesUnderRoots(std::vector<FQName>* packages) const {
+    std::set<FQName> found;
+
+    for (const PackageRoot& packageRoot : mPackageRoots) {
+        std::vector<FQName> rootPackages;
+        status_t err = appendPackagesUnderRoot(packageRoot.root.package(), &rootPackages);
+        if (err != OK) return err;
+        found.insert(rootPackages.begin(), rootPackages.end());
+    }
+
+    packages->insert(packages->end(), found.begin(), found.end());
+    return OK;
+}
+
+status_t Coordinator::appendPackagesUnderRoot(const std::string& root,
+                                              std::vector<FQName>* packages) const {
+    auto isRoot = [&](const PackageRoot& packageRoot) {
+        return packageRoot.root.package() == root;
+    };
+    if (std::find_if(mPackageRoots.begin(), mPackageRoots.end(), isRoot) == mPackageRoots.end()) {
+        fprintf(stderr, "ERROR: %s is not a package root.\n", root.c_str());
+        return NAME_NOT_FOUND;
+    }
+
+    std::set<FQName> found;
+
+    for (const PackageRoot& packageRoot : mPackageRoots) {
+        if (!isRoot(packageRoot)) continue;
+
+        // Directories to visit, relative to the package root path.
+        std::vector<std::string> toVisit = {""};
+
+        while (!toVisit.empty()) {
+            const std::string relativePath = toVisit.back();
+            toVisit.pop_back();
+
+            const std::string path = makeAbsolute(packageRoot.path + "/" + relativePath);
+            DIR* dir = opendir(path.c_str());
+            if (dir == nullptr) continue;  // e.x. a default root which isn't checked out
+
+            struct dirent* ent;
+            while ((ent = readdir(dir)) != nullptr) {
+                if (ent->d_name[0] == '.') continue;
+
+                if (ent->d_type == DT_UNKNOWN) {
+                    struct stat sb;
+                    if (stat((path + "/" + ent->d_name).c_str(), &sb) == -1 ||
+                        (sb.st_mode & S_IFMT) != S_IFDIR) {
+                        continue;
+                    }
+                } else if (ent->d_type != DT_DIR) {
+                    continue;
+                }
+
+                if (!isVersionDirectory(ent->d_name)) {
+                    toVisit.push_back(relativePath + ent->d_name + "/");
+                    continue;
+                }
+
+                std::string packageName = packageRoot.root.package();
+                if (!relativePath.empty()) {
+                    std::vector<std::string> components;
+                    StringHelper::SplitString(relativePath.substr(0, relativePath.size() - 1),
+                                              '/', &components);
+                    packageName += "." + StringHelper::JoinStrings(components, ".");
+                }
+
+                FQName package;
+                if (!FQName::parse(packageName + "@" + ent->d_name, &package)) {
+                    continue;  // not a package directory
+                }
+
+                std::vector<std::string> fileNames;
+                if (getPackageInterfaceFiles(package, &fileNames) == OK && !fileNames.empty()) {
+                    found.insert(package);
+                }
+            }
+            closedir(dir);
+        }
+    }
+
+    packages->insert(packages->end(), found.begin(), found.end());
+    return OK;
+}
+
 status_t Coordinator::isTypesOnlyPackage(const FQName& package, bool* result) const {
     std::vector<FQName> packageInterfaces;
 
@@ -555,7 +1304,8 @@ status_t Coordinator::isTypesOnlyPackage(const FQName& package, bool* result) co
 
 status_t Coordinator::addUnreferencedTypes(const std::vector<FQName>& packageInterfaces,
                                            std::set<FQName>* unreferencedDefinitions,
-                                           std::set<FQName>* unreferencedImports) const {
+                                           std::set<FQName>* unreferencedImports,
+                                           Enforce enforcement) const {
     CHECK(unreferencedDefinitions != nullptr);
     CHECK(unreferencedImports != nullptr);
 
@@ -565,7 +1315,7 @@ status_t Coordinator::addUnreferencedTypes(const std::vector<FQName>& packageInt
     std::set<FQName> typesDefinedTypes;  // only types.hal types
 
     for (const auto& fqName : packageInterfaces) {
-        AST* ast = parse(fqName);
+        AST* ast = parse(fqName, nullptr /* parsedASTs */, enforcement);
         if (!ast) {
             std::cerr << "ERROR: Could not parse " << fqName.string() << ". Aborting." << std::endl;
 
@@ -581,38 +1331,31 @@ status_t Coordinator::addUnreferencedTypes(const std::vector<FQName>& packageInt
         }
     }
 
-#if 0
-    for (const auto &fqName : packageDefinedTypes) {
-        std::cout << "VERBOSE: DEFINED " << fqName.string() << std::endl;
-    }
-
-    for (const auto &fqName : packageImportedTypes) {
-        std::cout << "VERBOSE: IMPORTED " << fqName.string() << std::endl;
-    }
-
-    for (const auto &fqName : packageReferencedTypes) {
-        std::cout << "VERBOSE: REFERENCED " << fqName.string() << std::endl;
-    }
-
-    for (const auto &fqName : typesDefinedTypes) {
-        std::cout << "VERBOSE: DEFINED in types.hal " << fqName.string() << std::endl;
-    }
-#endif
-
+    // Names are looked up by string in hashed sets rather than by FQName
+    // comparisons in the ordered ones.
+    std::unordered_set<std::string> referenced;
     for (const auto& fqName : packageReferencedTypes) {
-        packageDefinedTypes.erase(fqName);
-        packageImportedTypes.erase(fqName);
+        referenced.insert(fqName.string());
     }
-
     // A package implicitly imports its own types.hal, only track them in one set.
+    std::unordered_set<std::string> typesDefined;
     for (const auto& fqName : typesDefinedTypes) {
-        packageImportedTypes.erase(fqName);
+        typesDefined.insert(fqName.string());
     }
 
-    // defined but not referenced
-    unreferencedDefinitions->insert(packageDefinedTypes.begin(), packageDefinedTypes.end());
-    // imported but not referenced
-    unreferencedImports->insert(packageImportedTypes.begin(), packageImportedTypes.end());
+    for (const auto& fqName : packageDefinedTypes) {
+        // defined but not referenced
+        if (referenced.count(fqName.string()) == 0) {
+            unreferencedDefinitions->insert(fqName);
+        }
+    }
+    for (const auto& fqName : packageImportedTypes) {
+        // imported but not referenced
+        const std::string name = fqName.string();
+        if (referenced.count(name) == 0 && typesDefined.count(name) == 0) {
+            unreferencedImports->insert(fqName);
+        }
+    }
     return OK;
 }
 
@@ -635,28 +1378,28 @@ status_t Coordinator::enforceRestrictionsOnPackage(const FQName& fqName,
 
     FQName package = fqName.getPackageAndVersion();
     // look up cache.
-    if (mPackagesEnforced.find(package) != mPackagesEnforced.end()) {
+    auto enforced = mPackagesEnforced.find(package);
+    if (enforced != mPackagesEnforced.end() &&
+        (enforced->second == Enforce::FULL || enforced->second == enforcement)) {
         return OK;
     }
 
+    // cache it up front, as the checks below parse the files of package,
+    // which would otherwise enforce it again.
+    mPackagesEnforced[package] = enforcement;
+
     // enforce all rules.
     status_t err;
 
     err = enforceMinorVersionUprevs(package, enforcement);
-    if (err != OK) {
-        return err;
-    }
-
-    if (enforcement != Enforce::NO_HASH) {
+    if (err == OK && enforcement != Enforce::NO_HASH) {
         err = enforceHashes(package);
-        if (err != OK) {
-            return err;
-        }
     }
 
-    // cache it so that it won't need to be enforced again.
-    mPackagesEnforced.insert(package);
-    return OK;
+    if (err != OK) {
+        mPackagesEnforced.erase(package);
+    }
+    return err;
 }
 
 status_t Coordinator::enforceMinorVersionUprevs(const FQName& currentPackage,
@@ -747,11 +1490,13 @@ status_t Coordinator::enforceMinorVersionUprevs(const FQName& currentPackage,
         // Assume that currentFQName == android.hardware.foo@2.2::IFoo.
         FQName lastFQName(prevPackage.package(), prevPackage.version(),
                 currentFQName.name());
-        AST *lastAST = parse(lastFQName);
+        // Previous versions are enforced by their own build rules.
+        AST* lastAST = parse(lastFQName, nullptr /* parsedASTs */, Enforce::NONE);
 
         for (; lastFQName.getPackageMinorVersion() > 0 &&
                (lastAST == nullptr || lastAST->getInterface() == nullptr)
-             ; lastFQName = lastFQName.downRev(), lastAST = parse(lastFQName)) {
+             ; lastFQName = lastFQName.downRev(),
+               lastAST = parse(lastFQName, nullptr /* parsedASTs */, Enforce::NONE)) {
             // nothing
         }
 
@@ -798,50 +1543,140 @@ status_t Coordinator::enforceMinorVersionUprevs(const FQName& currentPackage,
 }
 
 Coordinator::HashStatus Coordinator::checkHash(const FQName& fqName) const {
-    AST* ast = parse(fqName);
+    {
+        std::lock_guard<std::mutex> lock(mHashStatusesMutex);
+        auto it = mHashStatuses.find(fqName);
+        if (it != mHashStatuses.end()) return it->second;
+    }
+
+    HashStatus status = computeHashStatus(fqName);
+
+    if (status == HashStatus::FROZEN || status == HashStatus::UNFROZEN) {
+        std::lock_guard<std::mutex> lock(mHashStatusesMutex);
+        mHashStatuses[fqName] = status;
+    }
+
+    return status;
+}
+
+Coordinator::HashStatus Coordinator::computeHashStatus(const FQName& fqName) const {
+    // Only the file's hash is needed here. Packages checked as dependencies
+    // of a frozen interface are enforced by their own build rules.
+    AST* ast = parse(fqName, nullptr /* parsedASTs */, Enforce::NONE);
     if (ast == nullptr) return HashStatus::ERROR;
 
+    std::string currentHash = ast->getFileHash()->hexString();
+    std::string error;
+    HashStatus status = lookupHashStatus(fqName, currentHash, &error);
+
+    switch (status) {
+        case HashStatus::ERROR: {
+            if (!error.empty()) std::cerr << "ERROR: " << error << std::endl;
+            break;
+        }
+        case HashStatus::UNFROZEN: {
+            // This ensures that it can be detected.
+            Hash::clearHash(ast->getFilename());
+            break;
+        }
+        case HashStatus::CHANGED: {
+            std::cerr << "ERROR: " << fqName.string() << " has hash " << currentHash
+                      << " which does not match hash on record. This interface has "
+                      << "been frozen. Do not change it!" << std::endl;
+            break;
+        }
+        case HashStatus::FROZEN:
+            break;
+    }
+
+    return status;
+}
+
+Coordinator::HashStatus Coordinator::lookupHashStatus(const FQName& fqName,
+                                                      const std::string& hash,
+                                                      std::string* error) const {
+    error->clear();
+
     std::string rootPath;
     status_t err = getPackageRootPath(fqName, &rootPath);
     if (err != OK) return HashStatus::ERROR;
 
     std::string hashPath = makeAbsolute(rootPath) + "/current.txt";
-    std::string error;
     bool fileExists;
     std::vector<std::string> frozen =
-        Hash::lookupHash(hashPath, fqName.string(), &error, &fileExists);
+        Hash::lookupHash(hashPath, fqName.string(), error, &fileExists);
     if (fileExists) onFileAccess(hashPath, "r");
 
-    if (error.size() > 0) {
-        std::cerr << "ERROR: " << error << std::endl;
-        return HashStatus::ERROR;
-    }
+    if (error->size() > 0) return HashStatus::ERROR;
 
     // hash not defined, interface not frozen
-    if (frozen.size() == 0) {
-        // This ensures that it can be detected.
-        Hash::clearHash(ast->getFilename());
+    if (frozen.size() == 0) return HashStatus::UNFROZEN;
 
-        return HashStatus::UNFROZEN;
+    if (std::find(frozen.begin(), frozen.end(), hash) == frozen.end()) {
+        return HashStatus::CHANGED;
     }
 
-    std::string currentHash = ast->getFileHash()->hexString();
+    return HashStatus::FROZEN;
+}
 
-    if (std::find(frozen.begin(), frozen.end(), currentHash) == frozen.end()) {
-        std::cerr << "ERROR: " << fqName.string() << " has hash " << currentHash
-                  << " which does not match hash on record. This interface has "
-                  << "been frozen. Do not change it!" << std::endl;
-        return HashStatus::CHANGED;
+status_t Coordinator::auditHashes(const std::vector<FQName>& packages,
+                                  std::vector<HashAuditEntry>* entries) const {
+    entries->clear();
+
+    std::vector<FQName> interfaces;
+    for (const FQName& package : packages) {
+        std::vector<FQName> packageInterfaces;
+        status_t err = appendPackageInterfacesToVector(package, &packageInterfaces);
+        if (err != OK) return err;
+        interfaces.insert(interfaces.end(), packageInterfaces.begin(), packageInterfaces.end());
     }
 
-    return HashStatus::FROZEN;
+    hashFiles(interfaces);
+
+    std::vector<FQName> frozen;
+    for (const FQName& fqName : interfaces) {
+        std::string packagePath;
+        status_t err =
+            getPackagePath(fqName, false /* relative */, false /* sanitized */, &packagePath);
+        if (err != OK) return err;
+
+        HashAuditEntry entry;
+        entry.fqName = fqName;
+        entry.hash = Hash::getHash(makeAbsolute(packagePath + fqName.name() + ".hal")).hexString();
+
+        std::string error;
+        entry.status = lookupHashStatus(fqName, entry.hash, &error);
+        if (!error.empty()) std::cerr << "ERROR: " << error << std::endl;
+
+        if (entry.status == HashStatus::FROZEN) frozen.push_back(fqName);
+
+        // Seed checkHash() so that getUnfrozenDependencies() below doesn't
+        // parse dependencies only to find their status again.
+        if (entry.status == HashStatus::FROZEN || entry.status == HashStatus::UNFROZEN) {
+            std::lock_guard<std::mutex> lock(mHashStatusesMutex);
+            mHashStatuses[fqName] = entry.status;
+        }
+
+        entries->push_back(std::move(entry));
+    }
+
+    prefetch(frozen);
+
+    for (HashAuditEntry& entry : *entries) {
+        if (entry.status != HashStatus::FROZEN) continue;
+
+        status_t err = getUnfrozenDependencies(entry.fqName, &entry.unfrozenDependencies);
+        if (err != OK) entry.status = HashStatus::ERROR;
+    }
+
+    return OK;
 }
 
 status_t Coordinator::getUnfrozenDependencies(const FQName& fqName,
                                               std::set<FQName>* result) const {
     CHECK(result != nullptr);
 
-    AST* ast = parse(fqName);
+    AST* ast = parse(fqName, nullptr /* parsedASTs */, Enforce::NONE);
     if (ast == nullptr) return UNKNOWN_ERROR;
 
     std::set<FQName> imported;
@@ -21,22 +21,38 @@
 #include <android-base/macros.h>
 #include <hidl-util/FQName.h>
 #include <hidl-util/Formatter.h>
+#include <time.h>
 #include <utils/Errors.h>
+#include <condition_variable>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace android {
 
 struct AST;
+struct OutputArchive;
 struct Type;
 
 struct Coordinator {
-    Coordinator() {};
+    Coordinator();
+    ~Coordinator();
 
     const std::string& getRootPath() const;
     void setRootPath(const std::string &rootPath);
+    const std::string& getOutputPath() const;
+
+    // Makes getFormatter() write outputs into the archive at path, named by
+    // their path relative to the output path, rather than into files. See
+    // OutputArchive for the formats supported.
+    status_t setOutputArchive(const std::string& path);
+    // Finishes the archive set by setOutputArchive(), if any.
+    status_t closeOutputArchive();
     void setOutputPath(const std::string& outputPath);
 
     void setVerbose(bool value);
@@ -44,9 +60,20 @@ struct Coordinator {
 
     void setDepFile(const std::string& depFile);
 
+    // If set, writeDepFile() also writes a depfile for each output, at the
+    // output's path relative to the output path, plus ".d", under depDir.
+    void setDepDir(const std::string& depDir);
+
     const std::string& getOwner() const;
     void setOwner(const std::string& owner);
 
+    // If more than one, parse() first scans the import statements of the
+    // requested file and of everything it transitively imports, and parses
+    // files which do not depend on each other concurrently on this many
+    // threads. Defaults to 1, i.e. imports are parsed one by one as the
+    // parser reaches them.
+    void setParseThreads(size_t threads);
+
     // adds path only if it doesn't exist
     status_t addPackagePath(const std::string& root, const std::string& path, std::string* error);
     // adds path if it hasn't already been added
@@ -69,7 +96,19 @@ struct Coordinator {
     // must be called before file access
     void onFileAccess(const std::string& path, const std::string& mode) const;
 
-    status_t writeDepFile(const std::string& forFile) const;
+    // Writes the depfile for outputFiles[0] (or the output archive), listing
+    // the dependencies of all of outputFiles, and a depfile for each output
+    // if setDepDir() was used and outputs aren't archived.
+    // The dependencies of an output are the files read and the files of the
+    // ASTs returned by parse() (with everything they import) from the time
+    // its Formatter was returned by getFormatter() up to the next output,
+    // plus files read before any output.
+    status_t writeDepFile(const std::vector<std::string>& outputFiles) const;
+
+    // Records inputs as the dependencies of outputFiles, which were copied
+    // from the output cache rather than generated.
+    void addOutputDependencies(const std::vector<std::string>& outputFiles,
+                               const std::vector<std::string>& inputs) const;
 
     enum class Enforce {
         FULL,     // default
@@ -82,7 +121,8 @@ struct Coordinator {
     // file if it exists.
     // If "parsedASTs" is non-NULL, successfully parsed ASTs are inserted
     // into the set.
-    // If !enforce, enforceRestrictionsOnPackage won't be run.
+    // If !enforce, enforceRestrictionsOnPackage won't be run. Otherwise it
+    // is run even if fqName was parsed (as an import) without enforcement.
     AST* parse(const FQName& fqName, std::set<AST*>* parsedASTs = nullptr,
                Enforce enforcement = Enforce::FULL) const;
 
@@ -95,6 +135,18 @@ struct Coordinator {
     status_t parseOptional(const FQName& fqName, AST** ast, std::set<AST*>* parsedASTs = nullptr,
                            Enforce enforcement = Enforce::FULL) const;
 
+    struct DefinedType {
+        AST* ast;
+        FQName fullName;
+        Type* type;
+    };
+
+    // Appends to candidates the types defined in parsed files whose full
+    // name has the same last component as fqName (e.x. "Folder" for
+    // "IFoo.Folder"). Whether they match fqName is still to be checked with
+    // FQName::endsWith.
+    void lookupDefinedTypes(const FQName& fqName, std::vector<DefinedType>* candidates) const;
+
     // Given package-root paths of ["hardware/interfaces",
     // "vendor/<something>/interfaces"], package roots of
     // ["android.hardware", "vendor.<something>.hardware"], and a
@@ -120,10 +172,61 @@ struct Coordinator {
 
     status_t isTypesOnlyPackage(const FQName& package, bool* result) const;
 
+    // Appends every package (e.x. android.hardware.nfc@1.0) found under the
+    // paths of the package roots, in order.
+    status_t appendPackagesUnderRoots(std::vector<FQName>* packages) const;
+    // Same as appendPackagesUnderRoots, but only for the package root of
+    // root (e.x. "android.hardware").
+    status_t appendPackagesUnderRoot(const std::string& root,
+                                     std::vector<FQName>* packages) const;
+
+    // Parses fqNames and the files they import without enforcing
+    // restrictions, on as many threads as set by setParseThreads(). Files
+    // which fail to parse are cached as such, so parse() returns nullptr
+    // for them afterwards.
+    void prefetch(const std::vector<FQName>& fqNames) const;
+
+    // Hashes the .hal files of fqNames (which must be fully qualified) on
+    // as many threads as set by setParseThreads(), without parsing them.
+    void hashFiles(const std::vector<FQName>& fqNames) const;
+
+    enum class HashStatus {
+        ERROR,
+        UNFROZEN,
+        FROZEN,
+        CHANGED,  // frozen but changed
+    };
+
+    struct HashAuditEntry {
+        FQName fqName;
+        std::string hash;
+        HashStatus status;
+        // only for FROZEN interfaces
+        std::set<FQName> unfrozenDependencies;
+    };
+
+    // Hashes every interface of packages in parallel and compares it
+    // against current.txt. Only frozen interfaces are parsed, to find their
+    // unfrozen dependencies. Unlike enforceRestrictionsOnPackage(), changed
+    // interfaces are reported in entries rather than on stderr.
+    status_t auditHashes(const std::vector<FQName>& packages,
+                         std::vector<HashAuditEntry>* entries) const;
+
+    // Computes the key under which the outputs generated for fqName by -L
+    // format are cached: a hash of hidl-gen's binaries (by path, size and
+    // modification time), of the options outputs depend on, and of every
+    // file they could be generated from. These are all files of fqName's
+    // package, of every package it transitively imports, and of their
+    // previous minor versions (for enforcement), and the current.txt of
+    // their package roots. inputs is set to those files.
+    status_t getOutputCacheKey(const FQName& fqName, const std::string& format,
+                               std::string* key, std::vector<std::string>* inputs) const;
+
     // Returns types which are imported/defined but not referenced in code
     status_t addUnreferencedTypes(const std::vector<FQName>& packageInterfaces,
                                   std::set<FQName>* unreferencedDefinitions,
-                                  std::set<FQName>* unreferencedImports) const;
+                                  std::set<FQName>* unreferencedImports,
+                                  Enforce enforcement = Enforce::FULL) const;
 
     // Enforce a set of restrictions on a set of packages. These include:
     //    - minor version upgrades
@@ -132,16 +235,51 @@ struct Coordinator {
     status_t enforceRestrictionsOnPackage(const FQName& fqName,
                                           Enforce enforcement = Enforce::FULL) const;
 
-private:
+    // Creates the directories containing path, if they don't exist yet.
     static bool MakeParentHierarchy(const std::string &path);
 
-    enum class HashStatus {
-        ERROR,
-        UNFROZEN,
-        FROZEN,
-        CHANGED,  // frozen but changed
-    };
+private:
+    // parseOptional, without prefetching imports.
+    status_t lookupOrParse(const FQName& fqName, AST** ast, std::set<AST*>* parsedASTs,
+                           Enforce enforcement) const;
+    // Parses the file for fqName, which must not be in mCache yet.
+    status_t parseUncached(const FQName& fqName, AST** ast, std::set<AST*>* parsedASTs,
+                           Enforce enforcement) const;
+
+    // Reads the file at path, or hands over the contents already read by scanImports.
+    bool readFile(const std::string& path, std::string* content) const;
+
+    // Lexes only the package and import statements of the file for fqName,
+    // and adds the files they refer to (including the implicitly imported
+    // types.hal and IBase) to imports. Returns NAME_NOT_FOUND if the file
+    // doesn't exist.
+    status_t scanImports(const FQName& fqName, std::set<FQName>* imports) const;
+    // Same as scanImports, given the content of the file for fqName.
+    void appendImports(const FQName& fqName, const std::string& content,
+                       std::set<FQName>* imports) const;
+
+    // Parses the files transitively imported by fqName, but not fqName
+    // itself, on up to mParseThreads threads. A file is only parsed once all
+    // the files it imports have been.
+    void prefetchImports(const FQName& fqName) const;
+
+    // Fills in imports with the files transitively imported by roots (and
+    // the roots themselves), except for files which were parsed before.
+    void scanImportGraph(const std::vector<FQName>& roots,
+                         std::map<FQName, std::set<FQName>>* imports) const;
+    // Parses the keys of imports as described by prefetchImports.
+    void parseImportGraph(const std::map<FQName, std::set<FQName>>& imports) const;
+
+    // Results are memoized once an interface is known to be FROZEN or
+    // UNFROZEN; errors are reported again by every call.
     HashStatus checkHash(const FQName& fqName) const;
+    HashStatus computeHashStatus(const FQName& fqName) const;
+    // Looks up hash, the hash of fqName's file, in the current.txt of its
+    // package root. Neither parses fqName nor reports errors.
+    HashStatus lookupHashStatus(const FQName& fqName, const std::string& hash,
+                                std::string* error) const;
+    mutable std::mutex mHashStatusesMutex;
+    mutable std::map<FQName, HashStatus> mHashStatuses;
     status_t getUnfrozenDependencies(const FQName& fqName, std::set<FQName>* result) const;
 
     // indicates that packages in "android.hardware" will be looked up in hardware/interfaces
@@ -168,19 +306,80 @@ private:
     std::string mRootPath;    // root of android source tree (to locate package roots)
     std::string mOutputPath;  // root of output directory
     std::string mDepFile;     // location to write depfile
+    std::string mDepDir;      // directory to write per output depfiles
+    std::unique_ptr<OutputArchive> mOutputArchive;  // if set, where outputs are written
 
     // hidl-gen options
     bool mVerbose = false;
     std::string mOwner;
-
-    // cache to parse().
+    size_t mParseThreads = 1;
+
+    // Guards the members below, which are accessed by parse() from the
+    // worker threads of prefetchImports().
+    mutable std::mutex mParseMutex;
+    mutable std::condition_variable mParseCondition;
+
+    // Thread parsing each file which is mapped to nullptr in mCache.
+    mutable std::map<FQName, std::thread::id> mParsing;
+    // File each thread waits for another thread to finish parsing.
+    mutable std::map<std::thread::id, FQName> mWaitingFor;
+    // Whether the thread owner waits, directly or through other threads,
+    // for a file this thread is parsing. Must be called with mParseMutex held.
+    bool waitsForThisThread(std::thread::id owner) const;
+
+    // Files read by scanImports() which have not been parsed yet.
+    mutable std::map<std::string, std::string> mScannedFiles;
+
+    // cache to parse(). ASTs in it live until the process exits, like
+    // the rest of hidl-gen's allocations; freeing them would only slow
+    // down exit.
     mutable std::map<FQName, AST *> mCache;
 
-    // cache to enforceRestrictionsOnPackage().
-    mutable std::set<FQName> mPackagesEnforced;
+    // Types defined by the ASTs in mCache, keyed by the last component of
+    // their name.
+    mutable std::unordered_map<std::string, std::vector<DefinedType>> mDefinedTypesByLocalName;
+
+    // Adds the types defined by ast to, or removes them from,
+    // mDefinedTypesByLocalName. Must be called with mParseMutex held.
+    void indexDefinedTypes(AST* ast) const;
+    void unindexDefinedTypes(AST* ast) const;
+
+    // .hal files in each package directory read by readPackageDirectory(),
+    // keyed by absolute path.
+    struct PackageDirectory {
+        struct timespec mtime;
+        std::vector<std::string> fileNames;
+    };
+    mutable std::mutex mPackageDirectoriesMutex;
+    mutable std::map<std::string, PackageDirectory> mPackageDirectories;
+
+    // Lists the .hal files (without the suffix) in the directory at path,
+    // "types" first. The listing is only read again if the directory's
+    // mtime changed since it was last read.
+    status_t readPackageDirectory(const std::string& path,
+                                  std::vector<std::string>* fileNames) const;
+
+    // cache to enforceRestrictionsOnPackage(), with the enforcement each
+    // package passed.
+    mutable std::map<FQName, Enforce> mPackagesEnforced;
 
+    // Files read while no output was being written, see writeDepFile().
     mutable std::set<std::string> mReadFiles;
 
+    struct OutputDependencies {
+        std::set<std::string> readFiles;
+        std::set<const AST*> asts;
+    };
+    // Keyed by output path. Only filled in if a depfile was requested.
+    mutable std::map<std::string, OutputDependencies> mOutputDependencies;
+    mutable OutputDependencies* mCurrentOutput = nullptr;
+
+    bool isTrackingDependencies() const;
+    status_t writeDepFile(const std::string& depFile, const std::string& forFile,
+                          const std::set<std::string>& dependencies) const;
+    void appendOutputDependencies(const std::string& outputFile,
+                                  std::set<std::string>* dependencies) const;
+
     // Returns the given path if it is absolute, otherwise it returns
     // the path relative to mRootPath
     std::string makeAbsolute(const std::string& string) const;
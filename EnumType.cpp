@@ -75,16 +75,18 @@ status_t EnumType::resolveInheritance() {
     return Scope::resolveInheritance();
 }
 
-std::vector<const Reference<Type>*> EnumType::getReferences() const {
-    return {&mStorageType};
+status_t EnumType::forEachReference(
+    const std::function<status_t(const Reference<Type>*)>& func) const {
+    return func(&mStorageType);
 }
 
-std::vector<const ConstantExpression*> EnumType::getConstantExpressions() const {
-    std::vector<const ConstantExpression*> ret;
+status_t EnumType::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>& func) const {
     for (const auto* value : mValues) {
-        ret.push_back(value->constExpr());
+        status_t err = func(value->constExpr());
+        if (err != OK) return err;
     }
-    return ret;
+    return OK;
 }
 
 status_t EnumType::validate() const {
@@ -583,6 +585,33 @@ void EnumType::emitVtsAttributeType(Formatter& out) const {
     out << "predefined_type: \"" << fullName() << "\"\n";
 }
 
+void EnumType::emitCppConsumeValue(Formatter& out, const std::string& provider,
+                                   const std::string& name, size_t /* depth */) const {
+    std::vector<std::string> valueNames;
+    forEachValueFromRoot(
+        [&](EnumValue* value) { valueNames.push_back(fullName() + "::" + value->name()); });
+
+    if (valueNames.empty()) {
+        out << name << " = static_cast<" << fullName() << ">(" << provider << ".ConsumeIntegral<"
+            << resolveToScalarType()->getCppStackType() << ">());\n";
+        return;
+    }
+
+    // Only values that are declared, so that the implementation isn't just
+    // exercised with rejected inputs.
+    out << name << " = " << provider << ".PickValueInArray<" << fullName() << ">({\n";
+    out.indent(2, [&] {
+        out.join(valueNames.begin(), valueNames.end(), ",\n",
+                 [&](const std::string& valueName) { out << valueName; });
+    });
+    out << "});\n";
+}
+
+void EnumType::emitCppLogValue(Formatter& out, const std::string& log, const std::string& name,
+                               bool isReader, size_t /* depth */) const {
+    emitCppLogValueRaw(out, log, name, isReader);
+}
+
 void EnumType::emitJavaDump(
         Formatter &out,
         const std::string &streamName,
@@ -807,13 +836,12 @@ void EnumValue::autofill(const EnumType* prevType, EnumValue* prevValue, const S
 
     mIsAutoFill = true;
     if (prevValue == nullptr) {
-        mValue = ConstantExpression::Zero(type->getKind()).release();
+        mAutofilledValue = ConstantExpression::Zero(type->getKind());
     } else {
-        std::string description = prevType->fullName() + "." + prevValue->name() + " implicitly";
-        auto* prevReference = new ReferenceConstantExpression(
-            Reference<LocalIdentifier>(prevValue, mLocation), description);
-        mValue = prevReference->addOne(type->getKind()).release();
+        mAutofilledValue = std::make_unique<AutofillConstantExpression>(
+            prevType, prevValue, mLocation, type->getKind());
     }
+    mValue = mAutofilledValue.get();
 }
 
 bool EnumValue::isAutoFill() const {
@@ -891,6 +919,18 @@ void BitFieldType::emitVtsAttributeType(Formatter& out) const {
         << "\"\n";
 }
 
+void BitFieldType::emitCppConsumeValue(Formatter& out, const std::string& provider,
+                                       const std::string& name, size_t /* depth */) const {
+    out << name << " = " << provider << ".ConsumeIntegral<"
+        << resolveToScalarType()->getCppStackType() << ">();\n";
+}
+
+void BitFieldType::emitCppLogValue(Formatter& out, const std::string& log,
+                                   const std::string& name, bool isReader,
+                                   size_t /* depth */) const {
+    emitCppLogValueRaw(out, log, name, isReader);
+}
+
 void BitFieldType::getAlignmentAndSize(size_t *align, size_t *size) const {
     resolveToScalarType()->getAlignmentAndSize(align, size);
 }
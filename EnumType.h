@@ -22,6 +22,7 @@
 #include "Reference.h"
 #include "Scope.h"
 
+#include <memory>
 #include <vector>
 
 namespace android {
@@ -66,8 +67,10 @@ struct EnumType : public Scope {
     // Return the type that corresponds to bitfield<T>.
     const BitFieldType* getBitfieldType() const;
 
-    std::vector<const Reference<Type>*> getReferences() const override;
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t forEachReference(
+        const std::function<status_t(const Reference<Type>*)>& func) const override;
+    status_t forEachConstantExpression(
+        const std::function<status_t(const ConstantExpression*)>& func) const override;
 
     status_t resolveInheritance() override;
     status_t validate() const override;
@@ -99,6 +102,10 @@ struct EnumType : public Scope {
 
     void emitVtsTypeDeclarations(Formatter& out) const override;
     void emitVtsAttributeType(Formatter& out) const override;
+    void emitCppConsumeValue(Formatter& out, const std::string& provider,
+                             const std::string& name, size_t depth) const override;
+    void emitCppLogValue(Formatter& out, const std::string& log, const std::string& name,
+                         bool isReader, size_t depth) const override;
 
     void emitJavaDump(
             Formatter &out,
@@ -159,6 +166,9 @@ struct EnumValue : public LocalIdentifier, DocCommentable {
     const Location mLocation;
     bool mIsAutoFill;
 
+    // Owns mValue if it was autofilled.
+    std::unique_ptr<ConstantExpression> mAutofilledValue;
+
     DISALLOW_COPY_AND_ASSIGN(EnumValue);
 };
 
@@ -193,6 +203,10 @@ struct BitFieldType : public TemplatedType {
     const EnumType* getEnumType() const;
 
     void emitVtsAttributeType(Formatter& out) const override;
+    void emitCppConsumeValue(Formatter& out, const std::string& provider,
+                             const std::string& name, size_t depth) const override;
+    void emitCppLogValue(Formatter& out, const std::string& log, const std::string& name,
+                         bool isReader, size_t depth) const override;
 
     void getAlignmentAndSize(size_t *align, size_t *size) const override;
 
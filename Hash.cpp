@@ -17,49 +17,122 @@
 #include "Hash.h"
 
 #include <algorithm>
-#include <fstream>
+#include <atomic>
+#include <cctype>
+#include <cstring>
 #include <iomanip>
 #include <map>
-#include <regex>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
+#include <android-base/macros.h>
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
 #include <openssl/sha.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 namespace android {
 
 const std::vector<uint8_t> Hash::kEmptyHash = std::vector<uint8_t>(SHA256_DIGEST_LENGTH, 0);
 
-Hash& Hash::getMutableHash(const std::string& path) {
-    static std::map<std::string, Hash> hashes;
+// Files may be hashed from several threads while imports are parsed in
+// parallel. References to map elements stay valid, so only the map itself
+// needs to be guarded.
+static std::mutex gHashesMutex;
+static std::map<std::string, Hash> gHashes;
+
+Hash& Hash::getMutableHash(const std::string& path, const std::string* content) {
+    {
+        std::lock_guard<std::mutex> lock(gHashesMutex);
+        auto it = gHashes.find(path);
+        if (it != gHashes.end()) {
+            return it->second;
+        }
+    }
+
+    Hash hash = content != nullptr ? Hash(path, *content) : Hash(path);
+
+    std::lock_guard<std::mutex> lock(gHashesMutex);
+    return gHashes.insert({path, std::move(hash)}).first->second;
+}
 
-    auto it = hashes.find(path);
+void Hash::hashFiles(const std::vector<std::string>& paths, size_t threads) {
+    CHECK(threads > 0);
 
-    if (hashes.find(path) == hashes.end()) {
-        it = hashes.insert(it, {path, Hash(path)});
+    std::vector<std::string> pending;
+    {
+        std::lock_guard<std::mutex> lock(gHashesMutex);
+        for (const std::string& path : paths) {
+            if (gHashes.find(path) == gHashes.end()) pending.push_back(path);
+        }
     }
 
-    return it->second;
+    // Each file is hashed independently, so workers just take the next one.
+    std::atomic<size_t> next(0);
+    auto worker = [&] {
+        for (size_t i = next++; i < pending.size(); i = next++) {
+            Hash hash(pending[i]);
+
+            std::lock_guard<std::mutex> lock(gHashesMutex);
+            gHashes.insert({pending[i], std::move(hash)});
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(threads, pending.size()); i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
 }
 
 const Hash& Hash::getHash(const std::string& path) {
     return getMutableHash(path);
 }
 
+const Hash& Hash::getHash(const std::string& path, const std::string& content) {
+    return getMutableHash(path, &content);
+}
+
 void Hash::clearHash(const std::string& path) {
     getMutableHash(path).mHash = kEmptyHash;
 }
 
+std::vector<uint8_t> Hash::sha256(const std::string& content) {
+    std::vector<uint8_t> ret = std::vector<uint8_t>(SHA256_DIGEST_LENGTH);
+
+    SHA256(reinterpret_cast<const uint8_t*>(content.data()), content.size(), ret.data());
+
+    return ret;
+}
+
+// Hashes the file in place rather than copying it into memory first. Like
+// before, a file which can't be read hashes as if it were empty.
 static std::vector<uint8_t> sha256File(const std::string &path) {
-    std::ifstream stream(path);
-    std::stringstream fileStream;
-    fileStream << stream.rdbuf();
-    std::string fileContent = fileStream.str();
+    base::unique_fd fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC)));
+    struct stat sb;
+    if (fd == -1 || fstat(fd, &sb) == -1 || sb.st_size == 0) {
+        return sha256("");
+    }
 
-    std::vector<uint8_t> ret = std::vector<uint8_t>(SHA256_DIGEST_LENGTH);
+    void* data = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        std::string fileContent;
+        base::ReadFileToString(path, &fileContent);
+        return sha256(fileContent);
+    }
 
-    SHA256(reinterpret_cast<const uint8_t *>(fileContent.c_str()),
-            fileContent.size(), ret.data());
+    std::vector<uint8_t> ret = std::vector<uint8_t>(SHA256_DIGEST_LENGTH);
+    SHA256(static_cast<const uint8_t*>(data), sb.st_size, ret.data());
+    munmap(data, sb.st_size);
 
     return ret;
 }
@@ -68,6 +141,10 @@ Hash::Hash(const std::string &path)
   : mPath(path),
     mHash(sha256File(path)) {}
 
+Hash::Hash(const std::string& path, const std::string& content)
+  : mPath(path),
+    mHash(sha256(content)) {}
+
 std::string Hash::hexString(const std::vector<uint8_t> &hash) {
     std::ostringstream s;
     s << std::hex << std::setfill('0');
@@ -89,27 +166,60 @@ const std::string &Hash::getPath() const {
     return mPath;
 }
 
-#define HASH "([0-9a-f]+)"
-#define FQNAME "([^\\s]+)"
-#define SPACES " +"
-#define MAYBE_SPACES " *"
-#define OPTIONAL_COMMENT "(?:#.*)?"
-static const std::regex kHashLine(
-    "(?:"
-        MAYBE_SPACES HASH SPACES FQNAME MAYBE_SPACES
-    ")?"
-    OPTIONAL_COMMENT);
+// Parses one line of a hash file, of the form
+//     [<spaces><hash><spaces><fqName><spaces>][#<comment>]
+// where the hash is lower case hex and the fqName is any run of
+// non-whitespace characters. Blank lines and comment lines leave hash and
+// fqName empty.
+static bool parseHashLine(const char* begin, const char* end, std::string* hash,
+                          std::string* fqName) {
+    hash->clear();
+    fqName->clear();
+
+    const char* it = begin;
+    const auto skipSpaces = [&] {
+        while (it != end && *it == ' ') it++;
+    };
+    const auto atCommentOrEnd = [&] { return it == end || *it == '#'; };
+
+    if (atCommentOrEnd()) return true;
+
+    skipSpaces();
+
+    const char* hashBegin = it;
+    while (it != end && ((*it >= '0' && *it <= '9') || (*it >= 'a' && *it <= 'f'))) it++;
+    if (it == hashBegin) return false;
+    const char* hashEnd = it;
+
+    skipSpaces();
+    if (it == hashEnd) return false;
+
+    const char* fqNameBegin = it;
+    while (it != end && !isspace(static_cast<unsigned char>(*it))) it++;
+    if (it == fqNameBegin) return false;
+    const char* fqNameEnd = it;
+
+    skipSpaces();
+    if (!atCommentOrEnd()) return false;
+
+    hash->assign(hashBegin, hashEnd);
+    fqName->assign(fqNameBegin, fqNameEnd);
+    return true;
+}
 
 struct HashFile {
-    static const HashFile *parse(const std::string &path, std::string *err) {
-        static std::map<std::string, HashFile*> hashfiles;
+    static const HashFile* parse(const std::string& path) {
+        static std::mutex mutex;
+        static std::map<std::string, std::unique_ptr<HashFile>> hashfiles;
+
+        std::lock_guard<std::mutex> lock(mutex);
         auto it = hashfiles.find(path);
 
         if (it == hashfiles.end()) {
-            it = hashfiles.insert(it, {path, readHashFile(path, err)});
+            it = hashfiles.insert(it, {path, readHashFile(path)});
         }
 
-        return it->second;
+        return it->second.get();
     }
 
     std::vector<std::string> lookup(const std::string &fqName) const {
@@ -122,63 +232,62 @@ struct HashFile {
         return it->second;
     }
 
-private:
-    static HashFile *readHashFile(const std::string &path, std::string *err) {
-        std::ifstream stream(path);
-        if (!stream) {
-            return nullptr;
-        }
+    bool exists = false;
+    // set if the file exists but could not be parsed
+    std::string error;
 
-        HashFile *file = new HashFile();
+private:
+    // Reads the whole file and indexes it in a single pass over its lines.
+    static std::unique_ptr<HashFile> readHashFile(const std::string& path) {
+        std::unique_ptr<HashFile> file(new HashFile());
         file->path = path;
 
-        std::string line;
-        while(std::getline(stream, line)) {
-            std::smatch match;
-            bool valid = std::regex_match(line, match, kHashLine);
-
-            if (!valid) {
-                *err = "Error reading line from " + path + ": " + line;
-                delete file;
-                return nullptr;
-            }
+        std::string content;
+        if (!base::ReadFileToString(path, &content)) {
+            return file;
+        }
+        file->exists = true;
 
-            CHECK_EQ(match.size(), 3u);
+        std::string hash;
+        std::string fqName;
 
-            std::string hash = match.str(1);
-            std::string fqName = match.str(2);
+        const char* end = content.data() + content.size();
+        for (const char* line = content.data(); line < end;) {
+            const char* lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+            if (lineEnd == nullptr) lineEnd = end;
 
-            if (hash.size() == 0 && fqName.size() == 0) {
-                continue;
+            if (!parseHashLine(line, lineEnd, &hash, &fqName)) {
+                file->error = "Error reading line from " + path + ": " + std::string(line, lineEnd);
+                file->hashes.clear();
+                return file;
             }
 
-            if (hash.size() == 0 || fqName.size() == 0) {
-                *err = "Hash or fqName empty on " + path + ": " + line;
-                delete file;
-                return nullptr;
+            if (!hash.empty()) {
+                file->hashes[fqName].push_back(hash);
             }
 
-            file->hashes[fqName].push_back(hash);
+            line = lineEnd + 1;
         }
+
         return file;
     }
 
     std::string path;
-    std::map<std::string,std::vector<std::string>> hashes;
+    std::unordered_map<std::string, std::vector<std::string>> hashes;
 };
 
 std::vector<std::string> Hash::lookupHash(const std::string& path, const std::string& interfaceName,
                                           std::string* err, bool* fileExists) {
     *err = "";
-    const HashFile *file = HashFile::parse(path, err);
+    const HashFile* file = HashFile::parse(path);
 
-    if (file == nullptr || err->size() > 0) {
-        if (fileExists != nullptr) *fileExists = false;
+    if (fileExists != nullptr) *fileExists = file->exists;
+
+    if (!file->exists || !file->error.empty()) {
+        *err = file->error;
         return {};
     }
 
-    if (fileExists != nullptr) *fileExists = true;
-
     return file->lookup(interfaceName);
 }
 
@@ -72,6 +72,12 @@ Interface::Interface(const char* localName, const FQName& fullName, const Locati
                      Scope* parent, const Reference<Type>& superType, const Hash* fileHash)
     : Scope(localName, fullName, location, parent), mSuperType(superType), mFileHash(fileHash) {}
 
+Interface::~Interface() {
+    for (Method* method : mReservedMethods) {
+        delete method;
+    }
+}
+
 std::string Interface::typeName() const {
     return "interface " + localName();
 }
@@ -459,46 +465,47 @@ bool Interface::addMethod(Method *method) {
     return true;
 }
 
-std::vector<const Reference<Type>*> Interface::getReferences() const {
-    std::vector<const Reference<Type>*> ret;
-
-    if (!isIBase()) {
-        ret.push_back(&mSuperType);
+status_t Interface::forEachMethod(const std::function<status_t(const Method*)>& func) const {
+    for (const auto* method : mUserMethods) {
+        status_t err = func(method);
+        if (err != OK) return err;
+    }
+    for (const auto* method : mReservedMethods) {
+        status_t err = func(method);
+        if (err != OK) return err;
     }
+    return OK;
+}
 
-    for (const auto* method : methods()) {
-        const auto& references = method->getReferences();
-        ret.insert(ret.end(), references.begin(), references.end());
+status_t Interface::forEachReference(
+    const std::function<status_t(const Reference<Type>*)>& func) const {
+    if (!isIBase()) {
+        status_t err = func(&mSuperType);
+        if (err != OK) return err;
     }
 
-    return ret;
+    return forEachMethod([&](const Method* method) { return method->forEachReference(func); });
 }
 
-std::vector<const ConstantExpression*> Interface::getConstantExpressions() const {
-    std::vector<const ConstantExpression*> ret;
-    for (const auto* method : methods()) {
-        const auto& retMethod = method->getConstantExpressions();
-        ret.insert(ret.end(), retMethod.begin(), retMethod.end());
-    }
-    return ret;
+status_t Interface::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>& func) const {
+    return forEachMethod(
+        [&](const Method* method) { return method->forEachConstantExpression(func); });
 }
 
-std::vector<const Reference<Type>*> Interface::getStrongReferences() const {
+status_t Interface::forEachStrongReference(
+    const std::function<status_t(const Reference<Type>*)>& func) const {
     // Interface is a special case as a reference:
     // its definiton must be completed for extension but
     // not necessary for other references.
 
-    std::vector<const Reference<Type>*> ret;
     if (!isIBase()) {
-        ret.push_back(&mSuperType);
-    }
-
-    for (const auto* method : methods()) {
-        const auto& references = method->getStrongReferences();
-        ret.insert(ret.end(), references.begin(), references.end());
+        status_t err = func(&mSuperType);
+        if (err != OK) return err;
     }
 
-    return ret;
+    return forEachMethod(
+        [&](const Method* method) { return method->forEachStrongReference(func); });
 }
 
 status_t Interface::resolveInheritance() {
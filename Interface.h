@@ -38,6 +38,7 @@ struct Interface : public Scope {
 
     Interface(const char* localName, const FQName& fullName, const Location& location,
               Scope* parent, const Reference<Type>& superType, const Hash* fileHash);
+    ~Interface() override;
 
     const Hash* getFileHash() const;
 
@@ -96,10 +97,13 @@ struct Interface : public Scope {
     std::string getJavaType(bool forInitializer) const override;
     std::string getVtsType() const override;
 
-    std::vector<const Reference<Type>*> getReferences() const override;
-    std::vector<const Reference<Type>*> getStrongReferences() const override;
+    status_t forEachReference(
+        const std::function<status_t(const Reference<Type>*)>& func) const override;
+    status_t forEachStrongReference(
+        const std::function<status_t(const Reference<Type>*)>& func) const override;
 
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t forEachConstantExpression(
+        const std::function<status_t(const ConstantExpression*)>& func) const override;
 
     status_t resolveInheritance() override;
     status_t validate() const override;
@@ -139,10 +143,15 @@ struct Interface : public Scope {
     Reference<Type> mSuperType;
 
     std::vector<Method*> mUserMethods;
+
+    // Copies made by addAllReservedMethods(), owned by this interface.
     std::vector<Method*> mReservedMethods;
 
     const Hash* mFileHash;
 
+    // Same as iterating over methods(), without copying them into a vector.
+    status_t forEachMethod(const std::function<status_t(const Method*)>& func) const;
+
     bool fillPingMethod(Method* method) const;
     bool fillDescriptorChainMethod(Method* method) const;
     bool fillGetDescriptorMethod(Method* method) const;
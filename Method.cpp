@@ -69,54 +69,34 @@ const std::vector<Annotation *> &Method::annotations() const {
     return *mAnnotations;
 }
 
-std::vector<Reference<Type>*> Method::getReferences() {
-    const auto& constRet = static_cast<const Method*>(this)->getReferences();
-    std::vector<Reference<Type>*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ref) { return const_cast<Reference<Type>*>(ref); });
-    return ret;
-}
-
-std::vector<const Reference<Type>*> Method::getReferences() const {
-    std::vector<const Reference<Type>*> ret;
-    ret.insert(ret.end(), mArgs->begin(), mArgs->end());
-    ret.insert(ret.end(), mResults->begin(), mResults->end());
-    return ret;
-}
-
-std::vector<Reference<Type>*> Method::getStrongReferences() {
-    const auto& constRet = static_cast<const Method*>(this)->getStrongReferences();
-    std::vector<Reference<Type>*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ref) { return const_cast<Reference<Type>*>(ref); });
-    return ret;
-}
-
-std::vector<const Reference<Type>*> Method::getStrongReferences() const {
-    std::vector<const Reference<Type>*> ret;
-    for (const auto* ref : getReferences()) {
-        if (!ref->shallowGet()->isNeverStrongReference()) {
-            ret.push_back(ref);
-        }
+status_t Method::forEachReference(
+    const std::function<status_t(const Reference<Type>*)>& func) const {
+    for (const auto* arg : *mArgs) {
+        status_t err = func(arg);
+        if (err != OK) return err;
     }
-    return ret;
+    for (const auto* result : *mResults) {
+        status_t err = func(result);
+        if (err != OK) return err;
+    }
+    return OK;
 }
 
-std::vector<ConstantExpression*> Method::getConstantExpressions() {
-    const auto& constRet = static_cast<const Method*>(this)->getConstantExpressions();
-    std::vector<ConstantExpression*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ce) { return const_cast<ConstantExpression*>(ce); });
-    return ret;
+status_t Method::forEachStrongReference(
+    const std::function<status_t(const Reference<Type>*)>& func) const {
+    return forEachReference([&](const Reference<Type>* ref) -> status_t {
+        if (ref->shallowGet()->isNeverStrongReference()) return OK;
+        return func(ref);
+    });
 }
 
-std::vector<const ConstantExpression*> Method::getConstantExpressions() const {
-    std::vector<const ConstantExpression*> ret;
+status_t Method::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>& func) const {
     for (const auto* annotation : *mAnnotations) {
-        const auto& retAnnotation = annotation->getConstantExpressions();
-        ret.insert(ret.end(), retAnnotation.begin(), retAnnotation.end());
+        status_t err = annotation->forEachConstantExpression(func);
+        if (err != OK) return err;
     }
-    return ret;
+    return OK;
 }
 
 void Method::cppImpl(MethodImplType type, Formatter &out) const {
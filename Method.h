@@ -68,14 +68,12 @@ struct Method : DocCommentable {
     bool isHiddenFromJava() const;
     const std::vector<Annotation *> &annotations() const;
 
-    std::vector<Reference<Type>*> getReferences();
-    std::vector<const Reference<Type>*> getReferences() const;
-
-    std::vector<Reference<Type>*> getStrongReferences();
-    std::vector<const Reference<Type>*> getStrongReferences() const;
-
-    std::vector<ConstantExpression*> getConstantExpressions();
-    std::vector<const ConstantExpression*> getConstantExpressions() const;
+    // See Type::forEachReference and friends.
+    status_t forEachReference(const std::function<status_t(const Reference<Type>*)>& func) const;
+    status_t forEachStrongReference(
+        const std::function<status_t(const Reference<Type>*)>& func) const;
+    status_t forEachConstantExpression(
+        const std::function<status_t(const ConstantExpression*)>& func) const;
 
     // Make a copy with the same name, args, results, oneway, annotations.
     // Implementations, serial are not copied.
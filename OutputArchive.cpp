@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "OutputArchive.h"
+
+#include <android-base/logging.h>
+#include <hidl-util/StringHelper.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ziparchive/zip_writer.h>
+#include <mutex>
+
+namespace android {
+
+static const size_t kTarBlockSize = 512;
+
+// Paths of the archives which are open, removed if the process exits
+// before they are closed.
+static std::mutex gOpenArchivesMutex;
+static std::set<std::string> gOpenArchives;
+
+static void removeOpenArchives() {
+    std::lock_guard<std::mutex> lock(gOpenArchivesMutex);
+    for (const std::string& path : gOpenArchives) {
+        unlink(path.c_str());
+    }
+    gOpenArchives.clear();
+}
+
+std::unique_ptr<OutputArchive> OutputArchive::Open(const std::string& path) {
+    Format format;
+    if (StringHelper::EndsWith(path, ".tar")) {
+        format = Format::TAR;
+    } else if (StringHelper::EndsWith(path, ".zip") || StringHelper::EndsWith(path, ".jar") ||
+               StringHelper::EndsWith(path, ".srcjar")) {
+        format = Format::ZIP;
+    } else {
+        fprintf(stderr, "ERROR: unknown archive format for %s. Expecting .tar, .zip, .jar or "
+                ".srcjar.\n", path.c_str());
+        return nullptr;
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "ERROR: could not open archive %s: %s\n", path.c_str(), strerror(errno));
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(gOpenArchivesMutex);
+        static bool registered = (atexit(removeOpenArchives), true);
+        (void)registered;
+        gOpenArchives.insert(path);
+    }
+
+    return std::unique_ptr<OutputArchive>(new OutputArchive(path, format, file));
+}
+
+OutputArchive::OutputArchive(const std::string& path, Format format, FILE* file)
+    : mPath(path), mFormat(format), mFile(file) {
+    if (mFormat == Format::ZIP) {
+        mZipWriter = std::make_unique<ZipWriter>(mFile);
+    }
+}
+
+OutputArchive::~OutputArchive() {
+    if (mFile != nullptr) {
+        remove();
+    }
+}
+
+void OutputArchive::remove() {
+    mZipWriter.reset();
+    fclose(mFile);
+    mFile = nullptr;
+    unlink(mPath.c_str());
+
+    std::lock_guard<std::mutex> lock(gOpenArchivesMutex);
+    gOpenArchives.erase(mPath);
+}
+
+const std::string& OutputArchive::getPath() const {
+    return mPath;
+}
+
+status_t OutputArchive::write(const std::string& data) {
+    if (fwrite(data.data(), 1, data.size(), mFile) != data.size()) {
+        fprintf(stderr, "ERROR: could not write to archive %s\n", mPath.c_str());
+        return UNKNOWN_ERROR;
+    }
+    return OK;
+}
+
+status_t OutputArchive::add(const std::string& name, const std::string& content) {
+    CHECK(mFile != nullptr);
+
+    status_t err;
+    if (!mNames.insert(name).second) {
+        fprintf(stderr, "ERROR: %s added to archive %s twice\n", name.c_str(), mPath.c_str());
+        err = ALREADY_EXISTS;
+    } else {
+        err = addEntry(name, content);
+    }
+
+    // Formatter doesn't check whether closing an entry succeeded, so the
+    // archive is failed as a whole.
+    if (err != OK) mFailed = true;
+    return err;
+}
+
+status_t OutputArchive::addEntry(const std::string& name, const std::string& content) {
+    switch (mFormat) {
+        case Format::TAR:
+            return addTarEntry(name, content);
+        case Format::ZIP:
+            return addZipEntry(name, content);
+    }
+    CHECK(false) << "Unknown archive format";
+    return UNKNOWN_ERROR;
+}
+
+status_t OutputArchive::addTarEntry(const std::string& name, const std::string& content) {
+    // ustar header. Names longer than 100 characters are split into a
+    // prefix and a name at a '/'.
+    std::string prefix;
+    std::string shortName = name;
+    if (shortName.size() > 100) {
+        const size_t split = name.rfind('/', 155);
+        if (split == std::string::npos || name.size() - split - 1 > 100) {
+            fprintf(stderr, "ERROR: name too long for tar archive: %s\n", name.c_str());
+            return UNKNOWN_ERROR;
+        }
+        prefix = name.substr(0, split);
+        shortName = name.substr(split + 1);
+    }
+
+    char header[kTarBlockSize];
+    memset(header, 0, sizeof(header));
+    memcpy(header, shortName.data(), shortName.size());
+    snprintf(header + 100, 8, "%07o", 0644);  // mode
+    snprintf(header + 108, 8, "%07o", 0);     // uid
+    snprintf(header + 116, 8, "%07o", 0);     // gid
+    snprintf(header + 124, 12, "%011llo", static_cast<unsigned long long>(content.size()));
+    snprintf(header + 136, 12, "%011o", 0);  // mtime
+    header[156] = '0';                       // regular file
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
+    memcpy(header + 345, prefix.data(), prefix.size());
+
+    // The checksum is computed with the checksum field set to spaces.
+    memset(header + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for (char c : header) {
+        checksum += static_cast<uint8_t>(c);
+    }
+    snprintf(header + 148, 8, "%06o", checksum);
+
+    std::string entry(header, sizeof(header));
+    entry += content;
+    entry.append((kTarBlockSize - content.size() % kTarBlockSize) % kTarBlockSize, '\0');
+
+    return write(entry);
+}
+
+status_t OutputArchive::addZipEntry(const std::string& name, const std::string& content) {
+    // Without zip64 the central directory counts entries in 16 bits.
+    if (mNames.size() > UINT16_MAX) {
+        fprintf(stderr, "ERROR: too many entries for zip archive %s\n", mPath.c_str());
+        return UNKNOWN_ERROR;
+    }
+
+    // Stored (flags 0) with the earliest timestamp zip can represent, which
+    // ZipWriter clamps time 0 to.
+    int32_t err = mZipWriter->StartEntryWithTime(name.c_str(), 0 /* flags */, 0 /* time */);
+    if (err == 0) err = mZipWriter->WriteBytes(content.data(), content.size());
+    if (err == 0) err = mZipWriter->FinishEntry();
+    if (err != 0) {
+        fprintf(stderr, "ERROR: could not add %s to archive %s: %s\n", name.c_str(),
+                mPath.c_str(), ZipWriter::ErrorCodeString(err));
+        return UNKNOWN_ERROR;
+    }
+    return OK;
+}
+
+// funopen() and fopencookie() take differently typed write functions.
+#ifdef __APPLE__
+using ArchiveEntrySize = int;
+using ArchiveEntryWritten = int;
+#else
+using ArchiveEntrySize = size_t;
+using ArchiveEntryWritten = ssize_t;
+#endif
+
+struct ArchiveEntry {
+    OutputArchive* archive;
+    std::string name;
+    std::string content;
+
+    static ArchiveEntryWritten write(void* cookie, const char* buffer, ArchiveEntrySize size) {
+        static_cast<ArchiveEntry*>(cookie)->content.append(buffer, size);
+        return size;
+    }
+
+    static int close(void* cookie) {
+        std::unique_ptr<ArchiveEntry> entry(static_cast<ArchiveEntry*>(cookie));
+        return entry->archive->add(entry->name, entry->content) == OK ? 0 : EOF;
+    }
+};
+
+FILE* OutputArchive::openEntry(const std::string& name) {
+    ArchiveEntry* entry = new ArchiveEntry{this, name, ""};
+
+#ifdef __APPLE__
+    FILE* file = funopen(entry, nullptr /* read */, &ArchiveEntry::write, nullptr /* seek */,
+                         &ArchiveEntry::close);
+#else
+    cookie_io_functions_t functions = {
+        nullptr /* read */, &ArchiveEntry::write, nullptr /* seek */, &ArchiveEntry::close,
+    };
+    FILE* file = fopencookie(entry, "w", functions);
+#endif
+
+    if (file == nullptr) {
+        delete entry;
+    }
+    return file;
+}
+
+status_t OutputArchive::close() {
+    CHECK(mFile != nullptr);
+
+    status_t err = mFailed ? UNKNOWN_ERROR : finish();
+    if (err != OK) {
+        fprintf(stderr, "ERROR: removing incomplete archive %s\n", mPath.c_str());
+        remove();
+        return err;
+    }
+
+    int result = fclose(mFile);
+    mFile = nullptr;
+    if (result != 0) {
+        fprintf(stderr, "ERROR: could not write archive %s\n", mPath.c_str());
+        unlink(mPath.c_str());
+    }
+
+    std::lock_guard<std::mutex> lock(gOpenArchivesMutex);
+    gOpenArchives.erase(mPath);
+    return result == 0 ? OK : UNKNOWN_ERROR;
+}
+
+status_t OutputArchive::finish() {
+    if (mFormat == Format::TAR) {
+        // Two empty blocks mark the end of the archive.
+        status_t err = write(std::string(2 * kTarBlockSize, '\0'));
+        if (err != OK) return err;
+    }
+
+    if (mFormat == Format::ZIP) {
+        // Writes the central directory.
+        int32_t err = mZipWriter->Finish();
+        if (err != 0) {
+            fprintf(stderr, "ERROR: could not write archive %s: %s\n", mPath.c_str(),
+                    ZipWriter::ErrorCodeString(err));
+            return UNKNOWN_ERROR;
+        }
+    }
+
+    if (fflush(mFile) != 0) {
+        fprintf(stderr, "ERROR: could not write archive %s\n", mPath.c_str());
+        return UNKNOWN_ERROR;
+    }
+    return OK;
+}
+
+}  // namespace android
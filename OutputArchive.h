@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OUTPUT_ARCHIVE_H_
+
+#define OUTPUT_ARCHIVE_H_
+
+#include <android-base/macros.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <utils/Errors.h>
+#include <memory>
+#include <set>
+#include <string>
+
+class ZipWriter;
+
+namespace android {
+
+// Single archive all outputs of an invocation are written to, instead of
+// one file each. The format is chosen by extension: ".tar" for a tar
+// archive, ".zip", ".jar" or ".srcjar" for an (uncompressed) zip archive.
+// Entries are stored in the order they are added, with fixed timestamps,
+// so that the archive only changes if the outputs do. An archive which
+// isn't closed successfully is removed, even if the process exits.
+struct OutputArchive {
+    // Returns nullptr (and reports why) if path has an unknown extension or
+    // can't be opened.
+    static std::unique_ptr<OutputArchive> Open(const std::string& path);
+
+    ~OutputArchive();
+
+    const std::string& getPath() const;
+
+    // Fails if name was already added.
+    status_t add(const std::string& name, const std::string& content);
+
+    // Returns a stream whose contents are added as name once it is closed.
+    FILE* openEntry(const std::string& name);
+
+    // Writes what follows the last entry (e.x. the zip central directory).
+    // Fails, and removes the archive, if any entry couldn't be added.
+    status_t close();
+
+   private:
+    enum class Format {
+        TAR,
+        ZIP,
+    };
+
+    OutputArchive(const std::string& path, Format format, FILE* file);
+
+    status_t addEntry(const std::string& name, const std::string& content);
+    status_t finish();
+    void remove();
+
+    status_t write(const std::string& data);
+    status_t addTarEntry(const std::string& name, const std::string& content);
+    status_t addZipEntry(const std::string& name, const std::string& content);
+
+    const std::string mPath;
+    const Format mFormat;
+    FILE* mFile;
+    std::unique_ptr<ZipWriter> mZipWriter;  // for Format::ZIP
+    std::set<std::string> mNames;
+    bool mFailed = false;  // if an entry couldn't be added
+
+    DISALLOW_COPY_AND_ASSIGN(OutputArchive);
+};
+
+}  // namespace android
+
+#endif  // OUTPUT_ARCHIVE_H_
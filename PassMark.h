@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PASS_MARK_H_
+
+#define PASS_MARK_H_
+
+#include <stddef.h>
+#include <atomic>
+
+namespace android {
+
+// Visited mark of a node for recursive passes (see Type::recursivePass and
+// ConstantExpression::recursivePass). Every pass takes a new generation and
+// a node is visited iff it is marked with it, so there is no per-pass
+// visited set to allocate and hash into.
+//
+// Passes may nest (e.x. a pass may parse another file, which runs its own
+// passes). A nested pass which marks nodes of the outer one makes the outer
+// pass visit them again, but never loops.
+struct PassMark {
+    // Returns a generation which no other pass, on any thread, has used.
+    static size_t newGeneration() {
+        static std::atomic<size_t> sLastGeneration{0};
+        return ++sLastGeneration;
+    }
+
+    // Returns false if the node was already visited by the pass of generation.
+    bool visit(size_t generation) const {
+        if (mGeneration == generation) return false;
+        mGeneration = generation;
+        return true;
+    }
+
+   private:
+    mutable size_t mGeneration = 0;
+};
+
+}  // namespace android
+
+#endif  // PASS_MARK_H_
@@ -30,8 +30,9 @@ std::string RefType::templatedTypeName() const {
     return "ref";
 }
 
-std::vector<const Reference<Type>*> RefType::getStrongReferences() const {
-    return {};
+status_t RefType::forEachStrongReference(
+    const std::function<status_t(const Reference<Type>*)>&) const {
+    return OK;
 }
 
 std::string RefType::getVtsType() const {
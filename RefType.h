@@ -32,7 +32,8 @@ struct RefType : public TemplatedType {
 
     bool isCompatibleElementType(const Type* elementType) const override;
 
-    std::vector<const Reference<Type>*> getStrongReferences() const override;
+    status_t forEachStrongReference(
+        const std::function<status_t(const Reference<Type>*)>& func) const override;
 
     std::string getCppType(StorageMode mode,
                            bool specifyNamespaces) const override;
@@ -282,6 +282,29 @@ void ScalarType::emitVtsTypeDeclarations(Formatter& out) const {
     out << "scalar_type: \"" << getVtsScalarType() << "\"\n";
 }
 
+void ScalarType::emitCppConsumeValue(Formatter& out, const std::string& provider,
+                                     const std::string& name, size_t /* depth */) const {
+    switch (mKind) {
+        case KIND_BOOL:
+            out << name << " = " << provider << ".ConsumeBool();\n";
+            break;
+        case KIND_FLOAT:
+        case KIND_DOUBLE:
+            out << name << " = " << provider << ".ConsumeFloatingPoint<" << getCppStackType()
+                << ">();\n";
+            break;
+        default:
+            out << name << " = " << provider << ".ConsumeIntegral<" << getCppStackType()
+                << ">();\n";
+            break;
+    }
+}
+
+void ScalarType::emitCppLogValue(Formatter& out, const std::string& log, const std::string& name,
+                                 bool isReader, size_t /* depth */) const {
+    emitCppLogValueRaw(out, log, name, isReader);
+}
+
 void ScalarType::getAlignmentAndSize(size_t *align, size_t *size) const {
     static const size_t kAlign[] = {
         1,  // bool, this is NOT standardized!
@@ -116,19 +116,21 @@ void Scope::setAnnotations(std::vector<Annotation*>* annotations) {
     mAnnotations = *annotations;
 }
 
-std::vector<const Type*> Scope::getDefinedTypes() const {
-    std::vector<const Type*> ret;
-    ret.insert(ret.end(), mTypes.begin(), mTypes.end());
-    return ret;
+status_t Scope::forEachDefinedType(const std::function<status_t(const Type*)>& func) const {
+    for (const auto* type : mTypes) {
+        status_t err = func(type);
+        if (err != OK) return err;
+    }
+    return OK;
 }
 
-std::vector<const ConstantExpression*> Scope::getConstantExpressions() const {
-    std::vector<const ConstantExpression*> ret;
+status_t Scope::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>& func) const {
     for (const auto* annotation : mAnnotations) {
-        const auto& retAnnotation = annotation->getConstantExpressions();
-        ret.insert(ret.end(), retAnnotation.begin(), retAnnotation.end());
+        status_t err = annotation->forEachConstantExpression(func);
+        if (err != OK) return err;
     }
-    return ret;
+    return OK;
 }
 
 void Scope::topologicalReorder(const std::unordered_map<const Type*, size_t>& reversedOrder) {
@@ -57,9 +57,11 @@ struct Scope : public NamedType {
 
     void setAnnotations(std::vector<Annotation*>* annotations);
 
-    std::vector<const Type*> getDefinedTypes() const override;
+    status_t forEachDefinedType(
+        const std::function<status_t(const Type*)>& func) const override;
 
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t forEachConstantExpression(
+        const std::function<status_t(const ConstantExpression*)>& func) const override;
 
     void topologicalReorder(const std::unordered_map<const Type*, size_t>& reversedOrder);
 
@@ -213,6 +213,20 @@ void StringType::emitVtsTypeDeclarations(Formatter& out) const {
     out << "type: " << getVtsType() << "\n";
 }
 
+void StringType::emitCppConsumeValue(Formatter& out, const std::string& provider,
+                                     const std::string& name, size_t /* depth */) const {
+    out << name << " = " << provider << ".ConsumeString();\n";
+}
+
+void StringType::emitCppLogValue(Formatter& out, const std::string& log, const std::string& name,
+                                 bool isReader, size_t /* depth */) const {
+    if (isReader) {
+        out << log << ".readString(&" << name << ");\n";
+    } else {
+        out << log << ".writeString(" << name << ");\n";
+    }
+}
+
 static HidlTypeAssertion assertion("hidl_string", 16 /* size */);
 void StringType::getAlignmentAndSize(size_t *align, size_t *size) const {
     *align = 8;  // hidl_string
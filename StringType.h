@@ -78,6 +78,10 @@ struct StringType : public Type {
     bool resultNeedsDeref() const override;
 
     void emitVtsTypeDeclarations(Formatter& out) const override;
+    void emitCppConsumeValue(Formatter& out, const std::string& provider,
+                             const std::string& name, size_t depth) const override;
+    void emitCppLogValue(Formatter& out, const std::string& log, const std::string& name,
+                         bool isReader, size_t depth) const override;
 
     void getAlignmentAndSize(size_t *align, size_t *size) const override;
 };
@@ -104,104 +104,89 @@ const Type* Type::resolve() const {
     return this;
 }
 
-std::vector<Type*> Type::getDefinedTypes() {
-    const auto& constRet = static_cast<const Type*>(this)->getDefinedTypes();
-    std::vector<Type*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* type) { return const_cast<Type*>(type); });
-    return ret;
+status_t Type::forEachDefinedType(const std::function<status_t(Type*)>& func) {
+    return static_cast<const Type*>(this)->forEachDefinedType(
+        [&](const Type* type) { return func(const_cast<Type*>(type)); });
 }
 
-std::vector<const Type*> Type::getDefinedTypes() const {
-    return {};
+status_t Type::forEachDefinedType(const std::function<status_t(const Type*)>&) const {
+    return OK;
 }
 
-std::vector<Reference<Type>*> Type::getReferences() {
-    const auto& constRet = static_cast<const Type*>(this)->getReferences();
-    std::vector<Reference<Type>*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ref) { return const_cast<Reference<Type>*>(ref); });
-    return ret;
+status_t Type::forEachReference(const std::function<status_t(Reference<Type>*)>& func) {
+    return static_cast<const Type*>(this)->forEachReference(
+        [&](const Reference<Type>* ref) { return func(const_cast<Reference<Type>*>(ref)); });
 }
 
-std::vector<const Reference<Type>*> Type::getReferences() const {
-    return {};
+status_t Type::forEachReference(const std::function<status_t(const Reference<Type>*)>&) const {
+    return OK;
 }
 
-std::vector<ConstantExpression*> Type::getConstantExpressions() {
-    const auto& constRet = static_cast<const Type*>(this)->getConstantExpressions();
-    std::vector<ConstantExpression*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ce) { return const_cast<ConstantExpression*>(ce); });
-    return ret;
+status_t Type::forEachConstantExpression(
+    const std::function<status_t(ConstantExpression*)>& func) {
+    return static_cast<const Type*>(this)->forEachConstantExpression(
+        [&](const ConstantExpression* ce) { return func(const_cast<ConstantExpression*>(ce)); });
 }
 
-std::vector<const ConstantExpression*> Type::getConstantExpressions() const {
-    return {};
+status_t Type::forEachConstantExpression(
+    const std::function<status_t(const ConstantExpression*)>&) const {
+    return OK;
 }
 
-std::vector<Reference<Type>*> Type::getStrongReferences() {
-    const auto& constRet = static_cast<const Type*>(this)->getStrongReferences();
-    std::vector<Reference<Type>*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ref) { return const_cast<Reference<Type>*>(ref); });
-    return ret;
+status_t Type::forEachStrongReference(const std::function<status_t(Reference<Type>*)>& func) {
+    return static_cast<const Type*>(this)->forEachStrongReference(
+        [&](const Reference<Type>* ref) { return func(const_cast<Reference<Type>*>(ref)); });
 }
 
-std::vector<const Reference<Type>*> Type::getStrongReferences() const {
-    std::vector<const Reference<Type>*> ret;
-    for (const auto* ref : getReferences()) {
-        if (!ref->shallowGet()->isNeverStrongReference()) {
-            ret.push_back(ref);
-        }
-    }
-    return ret;
+status_t Type::forEachStrongReference(
+    const std::function<status_t(const Reference<Type>*)>& func) const {
+    return forEachReference([&](const Reference<Type>* ref) -> status_t {
+        if (ref->shallowGet()->isNeverStrongReference()) return OK;
+        return func(ref);
+    });
+}
+
+status_t Type::recursivePass(const std::function<status_t(Type*)>& func) {
+    return recursivePass(func, PassMark::newGeneration());
+}
+
+status_t Type::recursivePass(const std::function<status_t(const Type*)>& func) const {
+    return recursivePass(func, PassMark::newGeneration());
 }
 
-status_t Type::recursivePass(const std::function<status_t(Type*)>& func,
-                             std::unordered_set<const Type*>* visited) {
+status_t Type::recursivePass(const std::function<status_t(Type*)>& func, size_t generation) {
     if (mIsPostParseCompleted) return OK;
 
-    if (visited->find(this) != visited->end()) return OK;
-    visited->insert(this);
+    if (!mVisited.visit(generation)) return OK;
 
     status_t err = func(this);
     if (err != OK) return err;
 
-    for (auto* nextType : getDefinedTypes()) {
-        err = nextType->recursivePass(func, visited);
-        if (err != OK) return err;
-    }
-
-    for (auto* nextRef : getReferences()) {
-        err = nextRef->shallowGet()->recursivePass(func, visited);
-        if (err != OK) return err;
-    }
+    err = forEachDefinedType(
+        [&](Type* nextType) { return nextType->recursivePass(func, generation); });
+    if (err != OK) return err;
 
-    return OK;
+    return forEachReference([&](Reference<Type>* nextRef) {
+        return nextRef->shallowGet()->recursivePass(func, generation);
+    });
 }
 
 status_t Type::recursivePass(const std::function<status_t(const Type*)>& func,
-                             std::unordered_set<const Type*>* visited) const {
+                             size_t generation) const {
     if (mIsPostParseCompleted) return OK;
 
-    if (visited->find(this) != visited->end()) return OK;
-    visited->insert(this);
+    if (!mVisited.visit(generation)) return OK;
 
     status_t err = func(this);
     if (err != OK) return err;
 
-    for (const auto* nextType : getDefinedTypes()) {
-        err = nextType->recursivePass(func, visited);
-        if (err != OK) return err;
-    }
-
-    for (const auto* nextRef : getReferences()) {
-        err = nextRef->shallowGet()->recursivePass(func, visited);
-        if (err != OK) return err;
-    }
+    err = forEachDefinedType(
+        [&](const Type* nextType) { return nextType->recursivePass(func, generation); });
+    if (err != OK) return err;
 
-    return OK;
+    return forEachReference([&](const Reference<Type>* nextRef) {
+        return nextRef->shallowGet()->recursivePass(func, generation);
+    });
 }
 
 status_t Type::resolveInheritance() {
@@ -228,41 +213,48 @@ Type::CheckAcyclicStatus Type::topologicalOrder(
     if (reversedOrder->find(this) != reversedOrder->end()) return CheckAcyclicStatus(OK);
     stack->insert(this);
 
-    for (const auto* nextType : getDefinedTypes()) {
+    // Status to return if a cycle is found while visiting children.
+    CheckAcyclicStatus ret(OK);
+
+    forEachDefinedType([&](const Type* nextType) -> status_t {
         auto err = nextType->topologicalOrder(reversedOrder, stack);
 
         if (err.status != OK) {
-            if (err.cycleEnd == nullptr) return err;
-
-            std::cerr << "  '" << nextType->typeName() << "' in '" << typeName() << "'";
-            if (nextType->isNamedType()) {
-                std::cerr << " at " << static_cast<const NamedType*>(nextType)->location();
-            }
-            std::cerr << "\n";
-
-            if (err.cycleEnd == this) {
-                return CheckAcyclicStatus(err.status);
+            if (err.cycleEnd != nullptr) {
+                std::cerr << "  '" << nextType->typeName() << "' in '" << typeName() << "'";
+                if (nextType->isNamedType()) {
+                    std::cerr << " at " << static_cast<const NamedType*>(nextType)->location();
+                }
+                std::cerr << "\n";
+
+                if (err.cycleEnd == this) {
+                    err = CheckAcyclicStatus(err.status);
+                }
             }
-            return err;
+            ret = err;
         }
-    }
+        return err.status;
+    });
+    if (ret.status != OK) return ret;
 
-    for (const auto* nextRef : getStrongReferences()) {
+    forEachStrongReference([&](const Reference<Type>* nextRef) -> status_t {
         const auto* nextType = nextRef->shallowGet();
         auto err = nextType->topologicalOrder(reversedOrder, stack);
 
         if (err.status != OK) {
-            if (err.cycleEnd == nullptr) return err;
-
-            std::cerr << "  '" << nextType->typeName() << "' in '" << typeName() << "' at "
-                      << nextRef->location() << "\n";
+            if (err.cycleEnd != nullptr) {
+                std::cerr << "  '" << nextType->typeName() << "' in '" << typeName() << "' at "
+                          << nextRef->location() << "\n";
 
-            if (err.cycleEnd == this) {
-                return CheckAcyclicStatus(err.status);
+                if (err.cycleEnd == this) {
+                    err = CheckAcyclicStatus(err.status);
+                }
             }
-            return err;
+            ret = err;
         }
-    }
+        return err.status;
+    });
+    if (ret.status != OK) return ret;
 
     CHECK(stack->find(this) != stack->end());
     stack->erase(this);
@@ -288,11 +280,9 @@ status_t Type::checkForwardReferenceRestrictions(const Reference<Type>& ref) con
     // If we support named templated types one day, we will need to change
     // this logic.
     if (!refType->isNamedType()) {
-        for (const Reference<Type>* innerRef : refType->getReferences()) {
-            status_t err = checkForwardReferenceRestrictions(*innerRef);
-            if (err != OK) return err;
-        }
-        return OK;
+        return refType->forEachReference([&](const Reference<Type>* innerRef) {
+            return checkForwardReferenceRestrictions(*innerRef);
+        });
     }
 
     const Location& typeLoc = static_cast<const NamedType*>(refType)->location();
@@ -337,23 +327,51 @@ bool Type::isElidableType() const {
 }
 
 bool Type::canCheckEquality() const {
+    bool ret;
+    if (mCanCheckEquality.get(&ret)) return ret;
+
     std::unordered_set<const Type*> visited;
-    return canCheckEquality(&visited);
+    ret = canCheckEquality(&visited);
+    if (mIsPostParseCompleted) mCanCheckEquality.set(ret);
+    if (ret) {
+        // See isJavaCompatible.
+        for (const Type* type : visited) {
+            bool cached;
+            if (type->mIsPostParseCompleted && !type->mCanCheckEquality.get(&cached)) {
+                type->mCanCheckEquality.set(ret);
+            }
+        }
+    }
+    return ret;
 }
 
 bool Type::canCheckEquality(std::unordered_set<const Type*>* visited) const {
     // See isJavaCompatible for similar structure.
+    bool ret;
+    if (mCanCheckEquality.get(&ret)) return ret;
     if (visited->find(this) != visited->end()) {
         return true;
     }
     visited->insert(this);
-    return deepCanCheckEquality(visited);
+    ret = deepCanCheckEquality(visited);
+    if (mIsPostParseCompleted && !ret) mCanCheckEquality.set(ret);
+    return ret;
 }
 
 bool Type::deepCanCheckEquality(std::unordered_set<const Type*>* /* visited */) const {
     return false;
 }
 
+bool Type::CachedProperty::get(bool* value) const {
+    uint8_t current = state.load(std::memory_order_relaxed);
+    if (current != kUnknown) *value = (current == kTrue);
+    return current != kUnknown;
+}
+
+void Type::CachedProperty::set(bool value) {
+    state.store(value ? kTrue : kFalse, std::memory_order_relaxed);
+}
+
 void Type::setPostParseCompleted() {
     CHECK(!mIsPostParseCompleted);
     mIsPostParseCompleted = true;
@@ -636,17 +654,35 @@ bool Type::resultNeedsDeref() const {
 }
 
 bool Type::needsResolveReferences() const {
+    bool ret;
+    if (mNeedsResolveReferences.get(&ret)) return ret;
+
     std::unordered_set<const Type*> visited;
-    return needsResolveReferences(&visited);
+    ret = needsResolveReferences(&visited);
+    if (mIsPostParseCompleted) mNeedsResolveReferences.set(ret);
+    if (!ret) {
+        // See isJavaCompatible.
+        for (const Type* type : visited) {
+            bool cached;
+            if (type->mIsPostParseCompleted && !type->mNeedsResolveReferences.get(&cached)) {
+                type->mNeedsResolveReferences.set(ret);
+            }
+        }
+    }
+    return ret;
 }
 
 bool Type::needsResolveReferences(std::unordered_set<const Type*>* visited) const {
     // See isJavaCompatible for similar structure.
+    bool ret;
+    if (mNeedsResolveReferences.get(&ret)) return ret;
     if (visited->find(this) != visited->end()) {
         return false;
     }
     visited->insert(this);
-    return deepNeedsResolveReferences(visited);
+    ret = deepNeedsResolveReferences(visited);
+    if (mIsPostParseCompleted && ret) mNeedsResolveReferences.set(ret);
+    return ret;
 }
 
 bool Type::deepNeedsResolveReferences(std::unordered_set<const Type*>* /* visited */) const {
@@ -694,17 +730,66 @@ void Type::emitVtsAttributeType(Formatter& out) const {
     emitVtsTypeDeclarations(out);
 }
 
+void Type::emitCppConsumeValue(Formatter&, const std::string&, const std::string&, size_t) const {}
+
+void Type::emitCppLogValue(Formatter&, const std::string&, const std::string&, bool,
+                           size_t) const {}
+
+void Type::emitCppLogValueRaw(Formatter& out, const std::string& log, const std::string& name,
+                              bool isReader) const {
+    if (isReader) {
+        out << log << ".read(&" << name << ");\n";
+    } else {
+        out << log << ".write(" << name << ");\n";
+    }
+}
+
 bool Type::isJavaCompatible() const {
+    bool ret;
+    if (mIsJavaCompatible.get(&ret)) return ret;
+
     std::unordered_set<const Type*> visited;
-    return isJavaCompatible(&visited);
+    ret = isJavaCompatible(&visited);
+    if (mIsPostParseCompleted) mIsJavaCompatible.set(ret);
+    if (ret) {
+        // Every type visited is reachable from this one, so none of them
+        // can lead to a different result either. Results which do differ
+        // were cached as they were found.
+        for (const Type* type : visited) {
+            bool cached;
+            if (type->mIsPostParseCompleted && !type->mIsJavaCompatible.get(&cached)) {
+                type->mIsJavaCompatible.set(ret);
+            }
+        }
+    }
+    return ret;
 }
 
 bool Type::containsPointer() const {
+    bool ret;
+    if (mContainsPointer.get(&ret)) return ret;
+
     std::unordered_set<const Type*> visited;
-    return containsPointer(&visited);
+    ret = containsPointer(&visited);
+    if (mIsPostParseCompleted) mContainsPointer.set(ret);
+    if (!ret) {
+        // See isJavaCompatible.
+        for (const Type* type : visited) {
+            bool cached;
+            if (type->mIsPostParseCompleted && !type->mContainsPointer.get(&cached)) {
+                type->mContainsPointer.set(ret);
+            }
+        }
+    }
+    return ret;
 }
 
 bool Type::isJavaCompatible(std::unordered_set<const Type*>* visited) const {
+    // A memoized value describes everything reachable from this vertex,
+    // so it can be used in place of walking it again.
+    bool ret;
+    if (mIsJavaCompatible.get(&ret)) return ret;
+
     // We need to find al least one path from requested vertex
     // to not java compatible.
     // That means that if we have already visited some vertex,
@@ -716,16 +801,24 @@ bool Type::isJavaCompatible(std::unordered_set<const Type*>* visited) const {
         return true;
     }
     visited->insert(this);
-    return deepIsJavaCompatible(visited);
+    ret = deepIsJavaCompatible(visited);
+    // Such a path doesn't depend on what was assumed for visited vertices,
+    // so a negative result is final and is cached as soon as it is found.
+    if (mIsPostParseCompleted && !ret) mIsJavaCompatible.set(ret);
+    return ret;
 }
 
 bool Type::containsPointer(std::unordered_set<const Type*>* visited) const {
     // See isJavaCompatible for similar structure.
+    bool ret;
+    if (mContainsPointer.get(&ret)) return ret;
     if (visited->find(this) != visited->end()) {
         return false;
     }
     visited->insert(this);
-    return deepContainsPointer(visited);
+    ret = deepContainsPointer(visited);
+    if (mIsPostParseCompleted && ret) mContainsPointer.set(ret);
+    return ret;
 }
 
 bool Type::deepIsJavaCompatible(std::unordered_set<const Type*>* /* visited */) const {
@@ -775,8 +868,9 @@ bool TemplatedType::isTemplatedType() const {
     return true;
 }
 
-std::vector<const Reference<Type>*> TemplatedType::getReferences() const {
-    return {&mElementType};
+status_t TemplatedType::forEachReference(
+    const std::function<status_t(const Reference<Type>*)>& func) const {
+    return func(&mElementType);
 }
 
 status_t TemplatedType::validate() const {
@@ -20,6 +20,7 @@
 
 #include <android-base/macros.h>
 #include <utils/Errors.h>
+#include <atomic>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -27,6 +28,7 @@
 #include <vector>
 
 #include "DocComment.h"
+#include "PassMark.h"
 #include "Reference.h"
 
 namespace android {
@@ -62,29 +64,35 @@ struct Type : DocCommentable {
     Type* resolve();
     virtual const Type* resolve() const;
 
+    // The forEach* methods below call func for every child stored in this
+    // type without copying them into a container. Iteration stops at the
+    // first call that doesn't return OK, and that status is returned.
+
     // All types defined in this type.
-    std::vector<Type*> getDefinedTypes();
-    virtual std::vector<const Type*> getDefinedTypes() const;
+    status_t forEachDefinedType(const std::function<status_t(Type*)>& func);
+    virtual status_t forEachDefinedType(const std::function<status_t(const Type*)>& func) const;
 
     // All types referenced in this type.
-    std::vector<Reference<Type>*> getReferences();
-    virtual std::vector<const Reference<Type>*> getReferences() const;
+    status_t forEachReference(const std::function<status_t(Reference<Type>*)>& func);
+    virtual status_t forEachReference(
+        const std::function<status_t(const Reference<Type>*)>& func) const;
 
     // All constant expressions referenced in this type.
-    std::vector<ConstantExpression*> getConstantExpressions();
-    virtual std::vector<const ConstantExpression*> getConstantExpressions() const;
+    status_t forEachConstantExpression(const std::function<status_t(ConstantExpression*)>& func);
+    virtual status_t forEachConstantExpression(
+        const std::function<status_t(const ConstantExpression*)>& func) const;
 
     // All types referenced in this type that must have completed
     // definiton before being referenced.
-    std::vector<Reference<Type>*> getStrongReferences();
-    virtual std::vector<const Reference<Type>*> getStrongReferences() const;
+    status_t forEachStrongReference(const std::function<status_t(Reference<Type>*)>& func);
+    virtual status_t forEachStrongReference(
+        const std::function<status_t(const Reference<Type>*)>& func) const;
 
     // Proceeds recursive pass
     // Makes sure to visit each node only once.
-    status_t recursivePass(const std::function<status_t(Type*)>& func,
-                           std::unordered_set<const Type*>* visited);
-    status_t recursivePass(const std::function<status_t(const Type*)>& func,
-                           std::unordered_set<const Type*>* visited) const;
+    // Passes must not be nested: func must not start another recursivePass.
+    status_t recursivePass(const std::function<status_t(Type*)>& func);
+    status_t recursivePass(const std::function<status_t(const Type*)>& func) const;
 
     // Recursive tree pass that completes type declarations
     // that depend on super types
@@ -290,6 +298,20 @@ struct Type : DocCommentable {
     // argument) or attribute of compound type for vts proto file.
     virtual void emitVtsAttributeType(Formatter& out) const;
 
+    // Generates code that sets name from values consumed from provider, a
+    // FuzzedDataProvider with ConsumeLength() and ConsumeString() to size
+    // vectors and strings, and Nested() for the provider of vector elements.
+    // Types that can't be made up from bytes, e.x. handles or interfaces,
+    // are left as they are.
+    virtual void emitCppConsumeValue(Formatter& out, const std::string& provider,
+                                     const std::string& name, size_t depth) const;
+
+    // Generates code that appends name to, or reads it back from, log, a
+    // record of calls (see -Lc++-recorder). Types that can't be recorded,
+    // e.x. handles or interfaces, are skipped and left as they are on read.
+    virtual void emitCppLogValue(Formatter& out, const std::string& log, const std::string& name,
+                                 bool isReader, size_t depth) const;
+
     // Returns true iff this type is supported through the Java backend.
     bool isJavaCompatible() const;
     bool isJavaCompatible(std::unordered_set<const Type*>* visited) const;
@@ -312,6 +334,10 @@ struct Type : DocCommentable {
    protected:
     void handleError(Formatter &out, ErrorMode mode) const;
 
+    // emitCppLogValue for types that are copied as they are laid out.
+    void emitCppLogValueRaw(Formatter& out, const std::string& log, const std::string& name,
+                            bool isReader) const;
+
     void emitReaderWriterEmbeddedForTypeName(
             Formatter &out,
             const std::string &name,
@@ -341,9 +367,35 @@ struct Type : DocCommentable {
             const std::string &name) const;
 
    private:
+    PassMark mVisited;
+
+    status_t recursivePass(const std::function<status_t(Type*)>& func, size_t generation);
+    status_t recursivePass(const std::function<status_t(const Type*)>& func,
+                           size_t generation) const;
+
+    // Memoized result of one of the recursive type-graph properties
+    // (needsResolveReferences, isJavaCompatible, containsPointer,
+    // canCheckEquality). The type graph cannot change once post parse
+    // passes are completed, so results are valid for the rest of the run.
+    // Results are cached for every type a traversal settles, not only the
+    // one queried, so that each type is walked about once. Imported types
+    // may be queried from several threads at once, hence the atomic.
+    struct CachedProperty {
+        enum : uint8_t { kUnknown, kFalse, kTrue };
+        std::atomic<uint8_t> state{kUnknown};
+
+        bool get(bool* value) const;
+        void set(bool value);
+    };
+
     bool mIsPostParseCompleted = false;
     Scope* const mParent;
 
+    mutable CachedProperty mCanCheckEquality;
+    mutable CachedProperty mNeedsResolveReferences;
+    mutable CachedProperty mIsJavaCompatible;
+    mutable CachedProperty mContainsPointer;
+
     DISALLOW_COPY_AND_ASSIGN(Type);
 };
 
@@ -359,7 +411,8 @@ struct TemplatedType : public Type {
 
     virtual bool isCompatibleElementType(const Type* elementType) const = 0;
 
-    std::vector<const Reference<Type>*> getReferences() const override;
+    status_t forEachReference(
+        const std::function<status_t(const Reference<Type>*)>& func) const override;
 
     virtual status_t validate() const override;
 
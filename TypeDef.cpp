@@ -59,8 +59,9 @@ const Type* TypeDef::resolve() const {
     return mReferencedType.get();
 }
 
-std::vector<const Reference<Type>*> TypeDef::getReferences() const {
-    return {&mReferencedType};
+status_t TypeDef::forEachReference(
+    const std::function<status_t(const Reference<Type>*)>& func) const {
+    return func(&mReferencedType);
 }
 
 bool TypeDef::needsEmbeddedReadWrite() const {
@@ -41,7 +41,8 @@ struct TypeDef : public NamedType {
 
     const Type* resolve() const override;
 
-    std::vector<const Reference<Type>*> getReferences() const override;
+    status_t forEachReference(
+        const std::function<status_t(const Reference<Type>*)>& func) const override;
 
     void emitTypeDeclarations(Formatter& out) const override;
 
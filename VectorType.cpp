@@ -79,8 +79,9 @@ bool VectorType::deepCanCheckEquality(std::unordered_set<const Type*>* visited)
     return mElementType->canCheckEquality(visited);
 }
 
-std::vector<const Reference<Type>*> VectorType::getStrongReferences() const {
-    return {};
+status_t VectorType::forEachStrongReference(
+    const std::function<status_t(const Reference<Type>*)>&) const {
+    return OK;
 }
 
 std::string VectorType::getCppType(StorageMode mode,
@@ -754,6 +755,37 @@ bool VectorType::deepContainsPointer(std::unordered_set<const Type*>* visited) c
 // All hidl_vec<T> have the same size.
 static HidlTypeAssertion assertion("hidl_vec<char>", 16 /* size */);
 
+void VectorType::emitCppConsumeValue(Formatter& out, const std::string& provider,
+                                     const std::string& name, size_t depth) const {
+    const std::string iteratorName = "_hidl_index_" + std::to_string(depth);
+
+    out << name << ".resize(" << provider << ".ConsumeLength());\n";
+    out << "for (size_t " << iteratorName << " = 0; " << iteratorName << " < " << name
+        << ".size(); ++" << iteratorName << ") {\n";
+    out.indent();
+    mElementType->emitCppConsumeValue(out, provider + ".Nested()", name + "[" + iteratorName + "]",
+                                      depth + 1);
+    out.unindent();
+    out << "}\n";
+}
+
+void VectorType::emitCppLogValue(Formatter& out, const std::string& log, const std::string& name,
+                                 bool isReader, size_t depth) const {
+    const std::string iteratorName = "_hidl_index_" + std::to_string(depth);
+
+    if (isReader) {
+        out << name << ".resize(" << log << ".readLength());\n";
+    } else {
+        out << log << ".writeLength(" << name << ".size());\n";
+    }
+    out << "for (size_t " << iteratorName << " = 0; " << iteratorName << " < " << name
+        << ".size(); ++" << iteratorName << ") {\n";
+    out.indent();
+    mElementType->emitCppLogValue(out, log, name + "[" + iteratorName + "]", isReader, depth + 1);
+    out.unindent();
+    out << "}\n";
+}
+
 void VectorType::getAlignmentAndSizeStatic(size_t *align, size_t *size) {
     *align = 8;  // hidl_vec<T>
     *size = assertion.size();
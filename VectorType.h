@@ -34,7 +34,8 @@ struct VectorType : public TemplatedType {
     std::string templatedTypeName() const override;
     bool isCompatibleElementType(const Type* elementType) const override;
 
-    std::vector<const Reference<Type>*> getStrongReferences() const override;
+    status_t forEachStrongReference(
+        const std::function<status_t(const Reference<Type>*)>& func) const override;
 
     bool deepCanCheckEquality(std::unordered_set<const Type*>* visited) const override;
 
@@ -120,6 +121,11 @@ struct VectorType : public TemplatedType {
             const std::string &offset,
             bool isReader);
 
+    void emitCppConsumeValue(Formatter& out, const std::string& provider,
+                             const std::string& name, size_t depth) const override;
+    void emitCppLogValue(Formatter& out, const std::string& log, const std::string& name,
+                         bool isReader, size_t depth) const override;
+
     bool needsEmbeddedReadWrite() const override;
     bool deepNeedsResolveReferences(std::unordered_set<const Type*>* visited) const override;
     bool resultNeedsDeref() const override;
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AST.h"
+
+#include "Interface.h"
+#include "Method.h"
+#include "Reference.h"
+
+#include <android-base/logging.h>
+#include <hidl-util/Formatter.h>
+#include <string>
+#include <vector>
+
+namespace android {
+
+// Lengths of vectors and strings in arguments, for methods that have any.
+static const std::vector<size_t> kBenchmarkLengths = {0, 16, 4096};
+// Lengths of vectors and strings in elements of vectors.
+static const size_t kNestedLength = 4;
+
+static bool hasVariableSize(const Method* method) {
+    for (const auto& arg : method->args()) {
+        if (arg->type().needsEmbeddedReadWrite()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AST::generateCppBenchmarkImplMethod(Formatter& out, const Method* method) const {
+    method->generateCppSignature(out);
+    out << " override ";
+    out.block([&] {
+        const NamedReference<Type>* elidedReturn = method->canElideCallback();
+        if (elidedReturn != nullptr) {
+            out << "return " << elidedReturn->type().getCppResultType() << " {};\n";
+            return;
+        }
+
+        // The stub aborts if the callback isn't called.
+        if (!method->results().empty()) {
+            out << "_hidl_cb(";
+            out.join(method->results().begin(), method->results().end(), ", ",
+                     [&](const auto&) { out << "{}"; });
+            out << ");\n";
+        }
+        out << "return ::android::hardware::Void();\n";
+    }).endl();
+}
+
+void AST::generateCppBenchmarkMethod(Formatter& out, const Method* method) const {
+    const std::string ifaceName = mRootScope.getInterface()->fqName().cppName();
+    const bool hasCallback = !method->canElideCallback() && !method->results().empty();
+
+    out << "void BM_" << method->name()
+        << "(::benchmark::State& _hidl_state, const ::android::sp<" << ifaceName
+        << ">& _hidl_target) ";
+    out.block([&] {
+        out << "ValueProvider _hidl_provider{"
+            << (hasVariableSize(method) ? "static_cast<size_t>(_hidl_state.range(0))" : "0")
+            << "};\n";
+        for (const auto& arg : method->args()) {
+            out << arg->type().getCppStackType() << " " << arg->name() << "{};\n";
+        }
+        for (const auto& arg : method->args()) {
+            arg->type().emitCppConsumeValue(out, "_hidl_provider", arg->name(), 0 /* depth */);
+        }
+        out.endl();
+
+        out << "for (auto _ : _hidl_state) ";
+        out.block([&] {
+            out << "auto _hidl_out = _hidl_target->" << method->name() << "(";
+            out.join(method->args().begin(), method->args().end(), ", ",
+                     [&](const auto& arg) { out << arg->name(); });
+            if (hasCallback) {
+                if (!method->args().empty()) {
+                    out << ", ";
+                }
+                out << "[](const auto&...) {}";
+            }
+            out << ");\n";
+            out.sIf("!_hidl_out.isOk()", [&] {
+                out << "_hidl_state.SkipWithError(_hidl_out.description().c_str());\n";
+                out << "break;\n";
+            }).endl();
+        }).endl();
+        out << "_hidl_state.SetItemsProcessed(_hidl_state.iterations());\n";
+    }).endl().endl();
+}
+
+void AST::generateCppBenchmarkSource(Formatter& out) const {
+    if (!AST::isInterface()) {
+        // types.hal has no methods to benchmark.
+        return;
+    }
+
+    const Interface* iface = mRootScope.getInterface();
+    const std::string ifaceName = iface->fqName().cppName();
+
+    std::vector<const Method*> methods;
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        if (!tuple.method()->isHidlReserved()) {
+            methods.push_back(tuple.method());
+        }
+    }
+
+    generateCppPackageInclude(out, mPackage, iface->getProxyName());
+    generateCppPackageInclude(out, mPackage, iface->getStubName());
+    generateCppPackageInclude(out, mPackage, iface->getPassthroughName());
+    out << "#include <benchmark/benchmark.h>\n";
+    out << "#include <errno.h>\n";
+    out << "#include <hidl/HidlTransportSupport.h>\n";
+    out << "#include <signal.h>\n";
+    out << "#include <stdio.h>\n";
+    out << "#include <sys/wait.h>\n";
+    out << "#include <unistd.h>\n";
+    out << "#include <initializer_list>\n";
+    out << "#include <string>\n\n";
+
+    out << "namespace {\n\n";
+
+    out << "// Makes up arguments (see Type::emitCppConsumeValue): the first enum value,\n"
+        << "// zeros, and vectors and strings of the given length. Elements of vectors\n"
+        << "// are kept small, so that only the outermost length grows.\n";
+    out << "struct ValueProvider ";
+    out.block([&] {
+        out << "size_t ConsumeLength() { return length; }\n";
+        out << "std::string ConsumeString() { return std::string(length, 'x'); }\n";
+        out << "ValueProvider& Nested() ";
+        out.block([&] {
+            out << "static ValueProvider nested{" << kNestedLength << "};\n";
+            out << "return nested;\n";
+        }).endl();
+        out << "bool ConsumeBool() { return false; }\n";
+        out << "template <typename T>\n";
+        out << "T ConsumeIntegral() { return T{}; }\n";
+        out << "template <typename T>\n";
+        out << "T ConsumeFloatingPoint() { return T{}; }\n";
+        out << "template <typename T>\n";
+        out << "T PickValueInArray(std::initializer_list<const T> values) "
+            << "{ return *values.begin(); }\n\n";
+        out << "const size_t length;\n";
+    });
+    out << ";\n\n";
+
+    out << "// Returns default results right away, so that only the transport is measured.\n";
+    out << "struct BenchmarkImpl : public " << ifaceName << " ";
+    out.block([&] {
+        for (const Method* method : methods) {
+            generateCppBenchmarkImplMethod(out, method);
+        }
+    });
+    out << ";\n\n";
+
+    for (const Method* method : methods) {
+        generateCppBenchmarkMethod(out, method);
+    }
+
+    out << "void registerBenchmarks(const std::string& transport, const ::android::sp<"
+        << ifaceName << ">& target) ";
+    out.block([&] {
+        for (const Method* method : methods) {
+            out << "::benchmark::RegisterBenchmark((\"" << iface->localName() << "::"
+                << method->name() << "/\" + transport).c_str(), BM_" << method->name()
+                << ", target)";
+            if (hasVariableSize(method)) {
+                for (size_t length : kBenchmarkLengths) {
+                    out << "->Arg(" << length << ")";
+                }
+            }
+            out << ";\n";
+        }
+    }).endl().endl();
+
+    out << "}  // namespace\n\n";
+
+    out << "int main(int argc, char** argv) ";
+    out.block([&] {
+        out << "// The server writes a byte to ready once it is registered. \"benchmark\" isn't\n";
+        out << "// in any manifest, so getService doesn't wait for it.\n";
+        out << "int ready[2];\n";
+        out.sIf("pipe(ready) != 0", [&] {
+            out << "perror(\"pipe\");\n";
+            out << "return 1;\n";
+        }).endl().endl();
+
+        out << "// Forked before anything uses binder, which doesn't survive a fork.\n";
+        out << "pid_t server = fork();\n";
+        out.sIf("server == 0", [&] {
+            out << "close(ready[0]);\n";
+            out << "::android::hardware::configureRpcThreadpool(1, true /* callerWillJoin */);\n";
+            out << "::android::sp<" << ifaceName << "> impl = new BenchmarkImpl();\n";
+            out.sIf("impl->registerAsService(\"benchmark\") != ::android::OK", [&] {
+                out << "fprintf(stderr, \"Could not register " << iface->fqName().string()
+                    << "/benchmark.\\n\");\n";
+                out << "_exit(1);\n";
+            }).endl();
+            out.sIf("write(ready[1], \"\", 1) != 1", [&] { out << "_exit(1);\n"; }).endl();
+            out << "close(ready[1]);\n";
+            out << "::android::hardware::joinRpcThreadpool();\n";
+            out << "_exit(1);\n";
+        }).endl();
+        out << "close(ready[1]);\n\n";
+
+        out.sIf("server > 0", [&] {
+            out << "char byte;\n";
+            out << "ssize_t n;\n";
+            out << "while ((n = read(ready[0], &byte, 1)) < 0 && errno == EINTR) {}\n";
+            out.sIf("n != 1", [&] {
+                out << "fprintf(stderr, \"The benchmark server exited early.\\n\");\n";
+                out << "waitpid(server, nullptr, 0);\n";
+                out << "server = -1;\n";
+            }).endl();
+        }).sElse([&] {
+            out << "perror(\"fork\");\n";
+        }).endl();
+        out << "close(ready[0]);\n\n";
+
+        out << "::android::sp<" << ifaceName << "> impl = new BenchmarkImpl();\n";
+        out << "registerBenchmarks(\"passthrough\", new "
+            << iface->getPassthroughFqName().cppName() << "(impl));\n";
+        out << "registerBenchmarks(\"binderized-in-process\", new "
+            << iface->getProxyFqName().cppName() << "(new " << iface->getStubFqName().cppName()
+            << "(impl)));\n\n";
+
+        out << "::android::sp<" << ifaceName << "> remote = server > 0 ? " << ifaceName
+            << "::getService(\"benchmark\") : nullptr;\n";
+        out.sIf("remote != nullptr", [&] {
+            out << "registerBenchmarks(\"binderized\", remote);\n";
+        }).sElse([&] {
+            out << "fprintf(stderr, \"Skipping out-of-process benchmarks, no server.\\n\");\n";
+        }).endl().endl();
+
+        out << "::benchmark::Initialize(&argc, argv);\n";
+        out << "::benchmark::RunSpecifiedBenchmarks();\n\n";
+
+        out.sIf("server > 0", [&] {
+            out << "kill(server, SIGKILL);\n";
+            out << "waitpid(server, nullptr, 0);\n";
+        }).endl();
+        out << "return 0;\n";
+    }).endl();
+}
+
+}  // namespace android
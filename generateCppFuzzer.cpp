@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AST.h"
+
+#include "Interface.h"
+#include "Method.h"
+#include "Reference.h"
+
+#include <android-base/logging.h>
+#include <hidl-util/Formatter.h>
+#include <string>
+#include <vector>
+
+namespace android {
+
+void AST::generateCppFuzzerMethod(Formatter& out, const Method* method) const {
+    out << "// " << method->name() << "\n";
+
+    for (const auto& arg : method->args()) {
+        out << arg->type().getCppStackType() << " " << arg->name() << "{};\n";
+    }
+    for (const auto& arg : method->args()) {
+        arg->type().emitCppConsumeValue(out, "_hidl_provider", arg->name(), 0 /* depth */);
+    }
+
+    const bool hasCallback = !method->canElideCallback() && !method->results().empty();
+
+    // The result is only checked so that a transport error doesn't abort.
+    out << "_hidl_target->" << method->name() << "(";
+    out.join(method->args().begin(), method->args().end(), ", ",
+             [&](const auto& arg) { out << arg->name(); });
+    if (hasCallback) {
+        if (!method->args().empty()) {
+            out << ", ";
+        }
+        out << "[](const auto&...) {}";
+    }
+    out << ").isOk();\n";
+}
+
+void AST::generateCppFuzzerSource(Formatter& out) const {
+    if (!AST::isInterface()) {
+        // types.hal has no methods to fuzz.
+        return;
+    }
+
+    const Interface* iface = mRootScope.getInterface();
+    const std::string ifaceName = iface->fqName().cppName();
+
+    std::vector<const Method*> methods;
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        if (!tuple.method()->isHidlReserved()) {
+            methods.push_back(tuple.method());
+        }
+    }
+
+    generateCppPackageInclude(out, mPackage, iface->getProxyName());
+    generateCppPackageInclude(out, mPackage, iface->getStubName());
+    out << "#include <fuzzer/FuzzedDataProvider.h>\n";
+    out << "#include <stdio.h>\n";
+    out << "#include <stdlib.h>\n\n";
+
+    out << "namespace {\n\n";
+
+    out << "// Bounds vectors and strings, so that inputs are spent on more calls\n"
+        << "// rather than on ever larger arguments.\n";
+    out << "constexpr size_t kMaxLength = 64;\n\n";
+
+    out << "struct ValueProvider : public FuzzedDataProvider ";
+    out.block([&] {
+        out << "using FuzzedDataProvider::FuzzedDataProvider;\n\n";
+        out << "size_t ConsumeLength() { return ConsumeIntegralInRange<size_t>(0, kMaxLength); }\n";
+        out << "std::string ConsumeString() { return ConsumeRandomLengthString(kMaxLength); }\n";
+        out << "ValueProvider& Nested() { return *this; }\n";
+    });
+    out << ";\n\n";
+
+    out << "// Calls go through " << iface->getProxyName() << " and " << iface->getStubName()
+        << " within this process, so that\n"
+        << "// unmarshalling is fuzzed along with the implementation.\n";
+    out << "const ::android::sp<" << ifaceName << ">& getTarget() ";
+    out.block([&] {
+        out << "static const ::android::sp<" << ifaceName << "> target = [] ";
+        out.block([&] {
+            out << "::android::sp<" << ifaceName << "> impl = " << ifaceName
+                << "::getService(\"default\", true /* getStub */);\n";
+            out.sIf("impl == nullptr", [&] {
+                out << "fprintf(stderr, \"No passthrough implementation of " << iface->fqName().string()
+                    << "/default.\\n\");\n";
+                out << "abort();\n";
+            }).endl();
+            out << "return ::android::sp<" << ifaceName << ">(new "
+                << iface->getProxyFqName().cppName() << "(new "
+                << iface->getStubFqName().cppName() << "(impl)));\n";
+        });
+        out << "();\n";
+        out << "return target;\n";
+    }).endl().endl();
+
+    out << "}  // namespace\n\n";
+
+    out << "extern \"C\" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) ";
+    out.block([&] {
+        out << "ValueProvider _hidl_provider(data, size);\n";
+        out << "const ::android::sp<" << ifaceName << ">& _hidl_target = getTarget();\n\n";
+
+        if (!methods.empty()) {
+            out << "while (_hidl_provider.remaining_bytes() > 0) ";
+            out.block([&] {
+                out << "switch (_hidl_provider.ConsumeIntegralInRange<size_t>(0, "
+                    << methods.size() - 1 << ")) ";
+                out.block([&] {
+                    for (size_t i = 0; i < methods.size(); ++i) {
+                        out << "case " << i << ": ";
+                        out.block([&] {
+                            generateCppFuzzerMethod(out, methods[i]);
+                            out << "break;\n";
+                        }).endl();
+                    }
+                }).endl();
+            }).endl().endl();
+        }
+
+        out << "return 0;\n";
+    }).endl();
+}
+
+}  // namespace android
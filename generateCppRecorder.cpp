@@ -0,0 +1,402 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AST.h"
+
+#include "Interface.h"
+#include "Method.h"
+#include "Reference.h"
+
+#include <android-base/logging.h>
+#include <hidl-util/Formatter.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Logs start with kRecordMagic and the name of the interface. Each call is
+// then recorded as:
+//     uint64_t nanoseconds since the recorder was created
+//     uint32_t index of the method in allMethodsFromRoot (without reserved methods)
+//     arguments and results, as written by Type::emitCppLogValue
+// Lengths are uint32_t, everything is in host byte order.
+
+namespace android {
+
+static const char* const kRecordMagic = "HIDLREC1";
+
+static std::vector<const Method*> recordedMethods(const Interface* iface) {
+    std::vector<const Method*> methods;
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        if (!tuple.method()->isHidlReserved()) {
+            methods.push_back(tuple.method());
+        }
+    }
+    return methods;
+}
+
+void AST::generateCppRecorderHeader(Formatter& out) const {
+    if (!AST::isInterface()) {
+        // types.hal has no calls to record.
+        return;
+    }
+
+    const Interface* iface = mRootScope.getInterface();
+    const std::string klassName = iface->localName() + "Recorder";
+    const std::string guard = makeHeaderGuard(klassName, true /* indicateGenerated */);
+
+    out << "#ifndef " << guard << "\n";
+    out << "#define " << guard << "\n\n";
+
+    generateCppPackageInclude(out, mPackage, iface->localName());
+    out << "#include <stdio.h>\n";
+    out << "#include <chrono>\n";
+    out << "#include <mutex>\n";
+    out << "#include <string>\n\n";
+
+    enterLeaveNamespace(out, true /* enter */);
+    out.endl();
+
+    out << "// Forwards calls to impl and appends the arguments and results of each\n"
+        << "// successful call to log, which " << iface->localName()
+        << "Replayer plays back.\n";
+    out << "struct " << klassName << " : public " << iface->localName() << " ";
+    out.block([&] {
+        out << klassName << "(const ::android::sp<" << iface->localName()
+            << ">& impl, FILE* log);\n\n";
+
+        generateMethods(out, [&](const Method* method, const Interface*) {
+            if (method->isHidlReserved()) {
+                return;
+            }
+            method->generateCppSignature(out);
+            out << " override;\n";
+        });
+
+        out << "private:\n";
+        out << "void record(const std::string& call);\n\n";
+        out << "const ::android::sp<" << iface->localName() << "> mImpl;\n";
+        out << "FILE* const mLog;\n";
+        out << "const std::chrono::steady_clock::time_point mStart;\n";
+        out << "std::mutex mLogLock;\n";
+    });
+    out << ";\n\n";
+
+    enterLeaveNamespace(out, false /* enter */);
+    out << "\n#endif  // " << guard << "\n";
+}
+
+void AST::generateCppRecorderMethod(Formatter& out, const std::string& className,
+                                    const Method* method, size_t index) const {
+    const NamedReference<Type>* elidedReturn = method->canElideCallback();
+    const bool hasCallback = elidedReturn == nullptr && !method->results().empty();
+
+    method->generateCppSignature(out, className);
+    out << " ";
+    out.block([&] {
+        out << "LogWriter _hidl_log;\n";
+        out << "_hidl_log.write(static_cast<uint64_t>(std::chrono::duration_cast<"
+            << "std::chrono::nanoseconds>(\n";
+        out.indent(2, [&] { out << "std::chrono::steady_clock::now() - mStart).count()));\n"; });
+        out << "_hidl_log.write(static_cast<uint32_t>(" << index << "));\n";
+        for (const auto& arg : method->args()) {
+            arg->type().emitCppLogValue(out, "_hidl_log", arg->name(), false /* isReader */,
+                                        0 /* depth */);
+        }
+        out.endl();
+
+        out << "auto _hidl_out = mImpl->" << method->name() << "(";
+        out.join(method->args().begin(), method->args().end(), ", ",
+                 [&](const auto& arg) { out << arg->name(); });
+        if (hasCallback) {
+            if (!method->args().empty()) {
+                out << ", ";
+            }
+            out << "[&](";
+            method->emitCppResultSignature(out);
+            out << ") ";
+            out.block([&] {
+                for (const auto& result : method->results()) {
+                    result->type().emitCppLogValue(out, "_hidl_log", result->name(),
+                                                   false /* isReader */, 0 /* depth */);
+                }
+                out << "_hidl_cb(";
+                out.join(method->results().begin(), method->results().end(), ", ",
+                         [&](const auto& result) { out << result->name(); });
+                out << ");\n";
+            });
+        }
+        out << ");\n";
+
+        out.sIf("_hidl_out.isOk()", [&] {
+            if (elidedReturn != nullptr) {
+                out << "const " << elidedReturn->type().getCppResultType()
+                    << " _hidl_result = _hidl_out;\n";
+                elidedReturn->type().emitCppLogValue(out, "_hidl_log", "_hidl_result",
+                                                     false /* isReader */, 0 /* depth */);
+            }
+            out << "record(_hidl_log.data);\n";
+        }).endl();
+        out << "return _hidl_out;\n";
+    }).endl().endl();
+}
+
+void AST::generateCppRecorderSource(Formatter& out) const {
+    if (!AST::isInterface()) {
+        // types.hal has no calls to record.
+        return;
+    }
+
+    const Interface* iface = mRootScope.getInterface();
+    const std::string klassName = iface->localName() + "Recorder";
+    const std::vector<const Method*> methods = recordedMethods(iface);
+
+    generateCppPackageInclude(out, mPackage, klassName);
+    out.endl();
+
+    enterLeaveNamespace(out, true /* enter */);
+    out.endl();
+
+    out << "namespace {\n\n";
+    out << "struct LogWriter ";
+    out.block([&] {
+        out << "template <typename T>\n";
+        out << "void write(const T& value) ";
+        out.block([&] {
+            out << "data.append(reinterpret_cast<const char*>(&value), sizeof(value));\n";
+        }).endl();
+        out << "void writeLength(size_t length) { write(static_cast<uint32_t>(length)); }\n";
+        out << "void writeString(const ::android::hardware::hidl_string& value) ";
+        out.block([&] {
+            out << "writeLength(value.size());\n";
+            out << "data.append(value.c_str(), value.size());\n";
+        }).endl().endl();
+        out << "std::string data;\n";
+    });
+    out << ";\n\n";
+    out << "}  // namespace\n\n";
+
+    out << klassName << "::" << klassName << "(const ::android::sp<" << iface->localName()
+        << ">& impl, FILE* log)\n";
+    out.indent(2, [&] {
+        out << ": mImpl(impl), mLog(log), mStart(std::chrono::steady_clock::now()) ";
+    });
+    out.block([&] {
+        out << "LogWriter header;\n";
+        out << "header.data = \"" << kRecordMagic << "\";\n";
+        out << "header.writeString(\"" << iface->fqName().string() << "\");\n";
+        out << "record(header.data);\n";
+    }).endl().endl();
+
+    out << "void " << klassName << "::record(const std::string& call) ";
+    out.block([&] {
+        out << "std::lock_guard<std::mutex> lock(mLogLock);\n";
+        out << "fwrite(call.data(), 1, call.size(), mLog);\n";
+    }).endl().endl();
+
+    for (size_t i = 0; i < methods.size(); ++i) {
+        generateCppRecorderMethod(out, klassName, methods[i], i);
+    }
+
+    enterLeaveNamespace(out, false /* enter */);
+}
+
+void AST::generateCppReplayerReads(Formatter& out,
+                                   const std::vector<NamedReference<Type>*>& args) const {
+    for (const auto& arg : args) {
+        out << arg->type().getCppStackType() << " " << arg->name() << "{};\n";
+    }
+    for (const auto& arg : args) {
+        arg->type().emitCppLogValue(out, "_hidl_log", arg->name(), true /* isReader */,
+                                    0 /* depth */);
+    }
+}
+
+void AST::generateCppReplayerSource(Formatter& out) const {
+    if (!AST::isInterface()) {
+        // types.hal has no calls to replay.
+        return;
+    }
+
+    const Interface* iface = mRootScope.getInterface();
+    const std::string ifaceName = iface->fqName().cppName();
+    const std::vector<const Method*> methods = recordedMethods(iface);
+
+    generateCppPackageInclude(out, mPackage, iface->localName());
+    out << "#include <errno.h>\n";
+    out << "#include <stdio.h>\n";
+    out << "#include <string.h>\n";
+    out << "#include <unistd.h>\n";
+    out << "#include <chrono>\n";
+    out << "#include <string>\n";
+    out << "#include <thread>\n\n";
+
+    out << "namespace {\n\n";
+    out << "struct LogReader ";
+    out.block([&] {
+        out << "template <typename T>\n";
+        out << "bool read(T* value) ";
+        out.block([&] {
+            out << "ok = ok && fread(value, sizeof(*value), 1, file) == 1;\n";
+            out << "return ok;\n";
+        }).endl();
+        out << "size_t readLength() ";
+        out.block([&] {
+            out << "uint32_t length = 0;\n";
+            out << "read(&length);\n";
+            out << "return length;\n";
+        }).endl();
+        out << "void readString(::android::hardware::hidl_string* value) ";
+        out.block([&] {
+            out << "std::string data(readLength(), '\\0');\n";
+            out << "ok = ok && fread(&data[0], 1, data.size(), file) == data.size();\n";
+            out << "*value = data;\n";
+        }).endl().endl();
+        out << "FILE* file;\n";
+        out << "bool ok = true;\n";
+    });
+    out << ";\n\n";
+
+    out << "void usage(const char* me) ";
+    out.block([&] {
+        out << "fprintf(stderr, \"usage: %s [-t] [-n <instance>] <log>\\n\", me);\n";
+        out << "fprintf(stderr, \"  -t: wait between calls as long as when they were "
+            << "recorded\\n\");\n";
+        out << "fprintf(stderr, \"  -n <instance>: instance of " << iface->fqName().string()
+            << " to call (default: default)\\n\");\n";
+    }).endl().endl();
+
+    out << "}  // namespace\n\n";
+
+    out << "int main(int argc, char** argv) ";
+    out.block([&] {
+        out << "bool _hidl_keepTiming = false;\n";
+        out << "std::string _hidl_instance = \"default\";\n\n";
+        out << "int _hidl_res;\n";
+        out << "while ((_hidl_res = getopt(argc, argv, \"tn:\")) >= 0) ";
+        out.block([&] {
+            out << "switch (_hidl_res) ";
+            out.block([&] {
+                out << "case 't': _hidl_keepTiming = true; break;\n";
+                out << "case 'n': _hidl_instance = optarg; break;\n";
+                out << "default: usage(argv[0]); return 1;\n";
+            }).endl();
+        }).endl();
+        out.sIf("optind + 1 != argc", [&] {
+            out << "usage(argv[0]);\n";
+            out << "return 1;\n";
+        }).endl().endl();
+
+        out << "LogReader _hidl_log{fopen(argv[optind], \"rb\")};\n";
+        out.sIf("_hidl_log.file == nullptr", [&] {
+            out << "fprintf(stderr, \"Could not open %s: %s\\n\", argv[optind], "
+                << "strerror(errno));\n";
+            out << "return 1;\n";
+        }).endl();
+
+        out << "char _hidl_magic[" << strlen(kRecordMagic) << "];\n";
+        out << "::android::hardware::hidl_string _hidl_name;\n";
+        out << "_hidl_log.read(&_hidl_magic);\n";
+        out << "_hidl_log.readString(&_hidl_name);\n";
+        out.sIf("!_hidl_log.ok || memcmp(_hidl_magic, \"" + std::string(kRecordMagic) +
+                    "\", sizeof(_hidl_magic)) != 0 || _hidl_name != \"" +
+                    iface->fqName().string() + "\"",
+                [&] {
+                    out << "fprintf(stderr, \"%s is not a log of " << iface->fqName().string()
+                        << " calls.\\n\", argv[optind]);\n";
+                    out << "return 1;\n";
+                })
+            .endl().endl();
+
+        out << "::android::sp<" << ifaceName << "> _hidl_target = " << ifaceName
+            << "::getService(_hidl_instance);\n";
+        out.sIf("_hidl_target == nullptr", [&] {
+            out << "fprintf(stderr, \"Could not get " << iface->fqName().string()
+                << "/%s.\\n\", _hidl_instance.c_str());\n";
+            out << "return 1;\n";
+        }).endl().endl();
+
+        out << "const auto _hidl_start = std::chrono::steady_clock::now();\n";
+        out << "size_t _hidl_calls = 0;\n";
+        out << "uint64_t _hidl_time;\n";
+        out << "uint32_t _hidl_method;\n";
+        out << "int _hidl_next;\n";
+        out << "while ((_hidl_next = fgetc(_hidl_log.file)) != EOF) ";
+        out.block([&] {
+            out << "ungetc(_hidl_next, _hidl_log.file);\n";
+            out << "_hidl_log.read(&_hidl_time);\n";
+            out << "_hidl_log.read(&_hidl_method);\n\n";
+            out << "// Results are read to get to the next call, but aren't compared.\n";
+            out << "switch (_hidl_method) ";
+            out.block([&] {
+                for (size_t i = 0; i < methods.size(); ++i) {
+                    const Method* method = methods[i];
+                    const NamedReference<Type>* elidedReturn = method->canElideCallback();
+                    const bool hasCallback =
+                        elidedReturn == nullptr && !method->results().empty();
+
+                    out << "case " << i << ": ";
+                    out.block([&] {
+                        out << "// " << method->name() << "\n";
+                        generateCppReplayerReads(out, method->args());
+                        if (!method->results().empty()) {
+                            // Results may be named like arguments.
+                            out.block([&] { generateCppReplayerReads(out, method->results()); })
+                                .endl();
+                        }
+                        out.sIf("!_hidl_log.ok", [&] { out << "break;\n"; }).endl();
+                        out.sIf("_hidl_keepTiming", [&] {
+                            out << "std::this_thread::sleep_until(_hidl_start + "
+                                << "std::chrono::nanoseconds(_hidl_time));\n";
+                        }).endl();
+                        out << "_hidl_target->" << method->name() << "(";
+                        out.join(method->args().begin(), method->args().end(), ", ",
+                                 [&](const auto& arg) { out << arg->name(); });
+                        if (hasCallback) {
+                            if (!method->args().empty()) {
+                                out << ", ";
+                            }
+                            out << "[](const auto&...) {}";
+                        }
+                        out << ").isOk();\n";
+                        out << "++_hidl_calls;\n";
+                        out << "break;\n";
+                    }).endl();
+                }
+                out << "default: ";
+                out.block([&] {
+                    out << "fprintf(stderr, \"Unknown method %u in %s.\\n\", _hidl_method, "
+                        << "argv[optind]);\n";
+                    out << "return 1;\n";
+                }).endl();
+            }).endl();
+            out.sIf("!_hidl_log.ok", [&] {
+                out << "fprintf(stderr, \"%s is truncated.\\n\", argv[optind]);\n";
+                out << "return 1;\n";
+            }).endl();
+        }).endl().endl();
+
+        out << "const auto _hidl_elapsed =\n";
+        out.indent(2, [&] {
+            out << "std::chrono::duration_cast<std::chrono::milliseconds>(\n";
+        });
+        out.indent(4, [&] { out << "std::chrono::steady_clock::now() - _hidl_start);\n"; });
+        out << "printf(\"Replayed %zu calls in %lld ms.\\n\", _hidl_calls, "
+            << "static_cast<long long>(_hidl_elapsed.count()));\n";
+        out << "return 0;\n";
+    }).endl();
+}
+
+}  // namespace android
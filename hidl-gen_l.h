@@ -20,13 +20,14 @@
 
 #include <utils/Errors.h>
 
-#include <stdio.h>
+#include <string>
 
 namespace android {
 
 // entry-point for file parsing
 // - contents of file are added to the AST
-// - expects file to already be open
-status_t parseFile(AST* ast, std::unique_ptr<FILE, std::function<void(FILE*)>> file);
+// - content is the whole file, already read into memory. It is scanned in
+//   place, without further copies, so it is temporarily modified.
+status_t parseFile(AST* ast, std::string* content);
 
 }  // namespace android
\ No newline at end of file
@@ -50,17 +50,23 @@ FQNAME              ({COMPONENT}|{VERSION})(({DOT}|":"+){COMPONENT}|{VERSION})*
 
 #include "hidl-gen_y.h"
 
+#include <android-base/logging.h>
 #include <assert.h>
 
 using namespace android;
 using token = yy::parser::token;
 
-static std::string gCurrentComment;
+// Per thread, since files may be lexed in parallel (see Coordinator::setParseThreads).
+static thread_local std::string gCurrentComment;
 
-#define SCALAR_TYPE(kind)                                        \
-    {                                                            \
-        yylval->type = new ScalarType(ScalarType::kind, *scope); \
-        return token::TYPE;                                      \
+// Nodes and token strings are owned by the arena of the AST being parsed.
+#define MAKE_NODE(T, ...) yyextra->getArena()->make<T>(__VA_ARGS__)
+#define INTERNED_YYTEXT yyextra->getArena()->intern(yytext, yyleng)
+
+#define SCALAR_TYPE(kind)                                               \
+    {                                                                   \
+        yylval->type = MAKE_NODE(ScalarType, ScalarType::kind, *scope); \
+        return token::TYPE;                                             \
     }
 
 #define YY_DECL int yylex(YYSTYPE* yylval_param, YYLTYPE* yylloc_param,  \
@@ -80,6 +86,7 @@ static std::string gCurrentComment;
 %option nounput
 %option noinput
 %option reentrant
+%option extra-type="android::AST*"
 %option bison-bridge
 %option bison-locations
 
@@ -91,7 +98,7 @@ static std::string gCurrentComment;
 "/**"                       { gCurrentComment.clear(); BEGIN(DOC_COMMENT_STATE); }
 <DOC_COMMENT_STATE>"*/"     {
                                 BEGIN(INITIAL);
-                                yylval->docComment = new DocComment(gCurrentComment);
+                                yylval->docComment = MAKE_NODE(DocComment, gCurrentComment);
                                 return token::DOC_COMMENT;
                             }
 <DOC_COMMENT_STATE>[^*\n]*                          { gCurrentComment += yytext; }
@@ -114,9 +121,9 @@ static std::string gCurrentComment;
 "struct"            { return token::STRUCT; }
 "typedef"           { return token::TYPEDEF; }
 "union"             { return token::UNION; }
-"bitfield"          { yylval->templatedType = new BitFieldType(*scope); return token::TEMPLATED; }
-"vec"               { yylval->templatedType = new VectorType(*scope); return token::TEMPLATED; }
-"ref"               { yylval->templatedType = new RefType(*scope); return token::TEMPLATED; }
+"bitfield"          { yylval->templatedType = MAKE_NODE(BitFieldType, *scope); return token::TEMPLATED; }
+"vec"               { yylval->templatedType = MAKE_NODE(VectorType, *scope); return token::TEMPLATED; }
+"ref"               { yylval->templatedType = MAKE_NODE(RefType, *scope); return token::TEMPLATED; }
 "oneway"            { return token::ONEWAY; }
 
 "bool"              { SCALAR_TYPE(KIND_BOOL); }
@@ -131,14 +138,14 @@ static std::string gCurrentComment;
 "float"             { SCALAR_TYPE(KIND_FLOAT); }
 "double"            { SCALAR_TYPE(KIND_DOUBLE); }
 
-"death_recipient"   { yylval->type = new DeathRecipientType(*scope); return token::TYPE; }
-"handle"            { yylval->type = new HandleType(*scope); return token::TYPE; }
-"memory"            { yylval->type = new MemoryType(*scope); return token::TYPE; }
-"pointer"           { yylval->type = new PointerType(*scope); return token::TYPE; }
-"string"            { yylval->type = new StringType(*scope); return token::TYPE; }
+"death_recipient"   { yylval->type = MAKE_NODE(DeathRecipientType, *scope); return token::TYPE; }
+"handle"            { yylval->type = MAKE_NODE(HandleType, *scope); return token::TYPE; }
+"memory"            { yylval->type = MAKE_NODE(MemoryType, *scope); return token::TYPE; }
+"pointer"           { yylval->type = MAKE_NODE(PointerType, *scope); return token::TYPE; }
+"string"            { yylval->type = MAKE_NODE(StringType, *scope); return token::TYPE; }
 
-"fmq_sync"          { yylval->type = new FmqType("::android::hardware", "MQDescriptorSync", *scope); return token::TEMPLATED; }
-"fmq_unsync"        { yylval->type = new FmqType("::android::hardware", "MQDescriptorUnsync", *scope); return token::TEMPLATED; }
+"fmq_sync"          { yylval->type = MAKE_NODE(FmqType, "::android::hardware", "MQDescriptorSync", *scope); return token::TEMPLATED; }
+"fmq_unsync"        { yylval->type = MAKE_NODE(FmqType, "::android::hardware", "MQDescriptorUnsync", *scope); return token::TEMPLATED; }
 
 "("                 { return('('); }
 ")"                 { return(')'); }
@@ -174,22 +181,22 @@ static std::string gCurrentComment;
 "?"                 { return('?'); }
 "@"                 { return('@'); }
 
-{COMPONENT}         { yylval->str = strdup(yytext); return token::IDENTIFIER; }
-{FQNAME}            { yylval->str = strdup(yytext); return token::FQNAME; }
+{COMPONENT}         { yylval->str = INTERNED_YYTEXT; return token::IDENTIFIER; }
+{FQNAME}            { yylval->str = INTERNED_YYTEXT; return token::FQNAME; }
 
-0[xX]{H}+{IS}?      { yylval->str = strdup(yytext); return token::INTEGER; }
-0{D}+{IS}?          { yylval->str = strdup(yytext); return token::INTEGER; }
-{D}+{IS}?           { yylval->str = strdup(yytext); return token::INTEGER; }
-L?\"(\\.|[^\\"])*\" { yylval->str = strdup(yytext); return token::STRING_LITERAL; }
+0[xX]{H}+{IS}?      { yylval->str = INTERNED_YYTEXT; return token::INTEGER; }
+0{D}+{IS}?          { yylval->str = INTERNED_YYTEXT; return token::INTEGER; }
+{D}+{IS}?           { yylval->str = INTERNED_YYTEXT; return token::INTEGER; }
+L?\"(\\.|[^\\"])*\" { yylval->str = INTERNED_YYTEXT; return token::STRING_LITERAL; }
 
-{D}+{E}{FS}?        { yylval->str = strdup(yytext); return token::FLOAT; }
-{D}+\.{E}?{FS}?     { yylval->str = strdup(yytext); return token::FLOAT; }
-{D}*\.{D}+{E}?{FS}? { yylval->str = strdup(yytext); return token::FLOAT; }
+{D}+{E}{FS}?        { yylval->str = INTERNED_YYTEXT; return token::FLOAT; }
+{D}+\.{E}?{FS}?     { yylval->str = INTERNED_YYTEXT; return token::FLOAT; }
+{D}*\.{D}+{E}?{FS}? { yylval->str = INTERNED_YYTEXT; return token::FLOAT; }
 
 \n|\r\n             { yylloc->lines(); }
 [ \t\f\v]           { /* ignore all other whitespace */ }
 
-.                   { yylval->str = strdup(yytext); return token::UNKNOWN; }
+.                   { yylval->str = INTERNED_YYTEXT; return token::UNKNOWN; }
 
 %%
 
@@ -197,16 +204,21 @@ L?\"(\\.|[^\\"])*\" { yylval->str = strdup(yytext); return token::STRING_LITERAL
 
 namespace android {
 
-status_t parseFile(AST* ast, std::unique_ptr<FILE, std::function<void(FILE *)>> file) {
+status_t parseFile(AST* ast, std::string* content) {
     yyscan_t scanner;
-    yylex_init(&scanner);
+    yylex_init_extra(ast, &scanner);
 
-    yyset_in(file.get(), scanner);
+    // yy_scan_buffer requires the buffer to end with two end-of-buffer chars.
+    content->append(2, YY_END_OF_BUFFER_CHAR);
+    YY_BUFFER_STATE buffer = yy_scan_buffer(&(*content)[0], content->size(), scanner);
+    CHECK(buffer != nullptr);
 
     Scope* scopeStack = ast->getRootScope();
     int res = yy::parser(scanner, ast, &scopeStack).parse();
 
+    yy_delete_buffer(buffer, scanner);
     yylex_destroy(scanner);
+    content->resize(content->size() - 2);
 
     if (res != 0 || ast->syntaxErrors() != 0) {
         return UNKNOWN_ERROR;
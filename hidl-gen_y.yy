@@ -42,6 +42,11 @@ using namespace android;
 
 extern int yylex(yy::parser::semantic_type*, yy::parser::location_type*, void*, Scope** const);
 
+template <typename T, typename... Args>
+T* make(AST* ast, Args&&... args) {
+    return ast->getArena()->make<T>(std::forward<Args>(args)...);
+}
+
 void enterScope(AST* /* ast */, Scope** scope, Scope* container) {
     CHECK(container->parent() == (*scope));
     *scope = container;
@@ -372,7 +377,7 @@ valid_type_name
 opt_annotations
     : /* empty */
       {
-          $$ = new std::vector<Annotation *>;
+          $$ = make<std::vector<Annotation *>>(ast);
       }
     | opt_annotations annotation
       {
@@ -384,14 +389,14 @@ opt_annotations
 annotation
     : '@' IDENTIFIER opt_annotation_params
       {
-          $$ = new Annotation($2, $3);
+          $$ = make<Annotation>(ast, $2, $3);
       }
     ;
 
 opt_annotation_params
     : /* empty */
       {
-          $$ = new AnnotationParamVector;
+          $$ = make<AnnotationParamVector>(ast);
       }
     | '(' annotation_params ')'
       {
@@ -402,7 +407,7 @@ opt_annotation_params
 annotation_params
     : annotation_param
       {
-          $$ = new AnnotationParamVector;
+          $$ = make<AnnotationParamVector>(ast);
           $$->push_back($1);
       }
     | annotation_params ',' annotation_param
@@ -415,18 +420,18 @@ annotation_params
 annotation_param
     : IDENTIFIER '=' annotation_string_value
       {
-          $$ = new StringAnnotationParam($1, $3);
+          $$ = make<StringAnnotationParam>(ast, $1, $3);
       }
     | IDENTIFIER '=' annotation_const_expr_value
       {
-          $$ = new ConstantExpressionAnnotationParam($1, $3);
+          $$ = make<ConstantExpressionAnnotationParam>(ast, $1, $3);
       }
     ;
 
 annotation_string_value
     : STRING_LITERAL
       {
-          $$ = new std::vector<std::string>;
+          $$ = make<std::vector<std::string>>(ast);
           $$->push_back($1);
       }
     | '{' annotation_string_values '}' { $$ = $2; }
@@ -435,7 +440,7 @@ annotation_string_value
 annotation_string_values
     : STRING_LITERAL
       {
-          $$ = new std::vector<std::string>;
+          $$ = make<std::vector<std::string>>(ast);
           $$->push_back($1);
       }
     | annotation_string_values ',' STRING_LITERAL
@@ -448,7 +453,7 @@ annotation_string_values
 annotation_const_expr_value
     : const_expr
       {
-          $$ = new std::vector<ConstantExpression *>;
+          $$ = make<std::vector<ConstantExpression *>>(ast);
           $$->push_back($1);
       }
     | '{' annotation_const_expr_values '}' { $$ = $2; }
@@ -457,7 +462,7 @@ annotation_const_expr_value
 annotation_const_expr_values
     : const_expr
       {
-          $$ = new std::vector<ConstantExpression *>;
+          $$ = make<std::vector<ConstantExpression *>>(ast);
           $$->push_back($1);
       }
     | annotation_const_expr_values ',' const_expr
@@ -487,7 +492,7 @@ require_semicolon
 fqname
     : FQNAME
       {
-          $$ = new FQName();
+          $$ = make<FQName>(ast);
           if(!FQName::parse($1, $$)) {
               std::cerr << "ERROR: FQName '" << $1 << "' is not valid at "
                         << @1
@@ -497,7 +502,7 @@ fqname
       }
     | valid_type_name
       {
-          $$ = new FQName();
+          $$ = make<FQName>(ast);
           if(!FQName::parse($1, $$)) {
               std::cerr << "ERROR: FQName '" << $1 << "' is not valid at "
                         << @1
@@ -510,11 +515,11 @@ fqname
 fqtype
     : fqname
       {
-          $$ = new Reference<Type>(*$1, convertYYLoc(@1));
+          $$ = make<Reference<Type>>(ast, *$1, convertYYLoc(@1));
       }
     | TYPE
       {
-          $$ = new Reference<Type>($1, convertYYLoc(@1));
+          $$ = make<Reference<Type>>(ast, $1, convertYYLoc(@1));
       }
     ;
 
@@ -664,7 +669,7 @@ interface_declaration
 
                   YYERROR;
               }
-              superType = new Reference<Type>();
+              superType = make<Reference<Type>>(ast);
           } else {
               if (!ast->addImport(gIBaseFqName.string().c_str())) {
                   std::cerr << "ERROR: Unable to automatically import '"
@@ -675,7 +680,7 @@ interface_declaration
               }
 
               if (superType == nullptr) {
-                  superType = new Reference<Type>(gIBaseFqName, convertYYLoc(@$));
+                  superType = make<Reference<Type>>(ast, gIBaseFqName, convertYYLoc(@$));
               }
           }
 
@@ -693,7 +698,7 @@ interface_declaration
               YYERROR;
           }
 
-          Interface* iface = new Interface(
+          Interface* iface = make<Interface>(ast,
               $2, ast->makeFullName($2, *scope), convertYYLoc(@2),
               *scope, *superType, ast->getFileHash());
 
@@ -718,7 +723,7 @@ typedef_declaration
           // The reason we wrap the given type in a TypeDef is simply to suppress
           // emitting any type definitions later on, since this is just an alias
           // to a type defined elsewhere.
-          TypeDef* typeDef = new TypeDef(
+          TypeDef* typeDef = make<TypeDef>(ast,
               $3, ast->makeFullName($3, *scope), convertYYLoc(@2), *scope, *$2);
           ast->addScopedType(typeDef, *scope);
           $$ = typeDef;
@@ -727,7 +732,7 @@ typedef_declaration
 
 const_expr
     : INTEGER                   {
-          $$ = LiteralConstantExpression::tryParse($1);
+          $$ = ast->getArena()->adopt(LiteralConstantExpression::tryParse($1));
 
           if ($$ == nullptr) {
               std::cerr << "ERROR: Could not parse literal: "
@@ -744,41 +749,41 @@ const_expr
               YYERROR;
           }
 
-          $$ = new ReferenceConstantExpression(
+          $$ = make<ReferenceConstantExpression>(ast,
               Reference<LocalIdentifier>(*$1, convertYYLoc(@1)), $1->string());
       }
     | const_expr '?' const_expr ':' const_expr
       {
-          $$ = new TernaryConstantExpression($1, $3, $5);
-      }
-    | const_expr LOGICAL_OR const_expr  { $$ = new BinaryConstantExpression($1, "||", $3); }
-    | const_expr LOGICAL_AND const_expr { $$ = new BinaryConstantExpression($1, "&&", $3); }
-    | const_expr '|' const_expr { $$ = new BinaryConstantExpression($1, "|" , $3); }
-    | const_expr '^' const_expr { $$ = new BinaryConstantExpression($1, "^" , $3); }
-    | const_expr '&' const_expr { $$ = new BinaryConstantExpression($1, "&" , $3); }
-    | const_expr EQUALITY const_expr { $$ = new BinaryConstantExpression($1, "==", $3); }
-    | const_expr NEQ const_expr { $$ = new BinaryConstantExpression($1, "!=", $3); }
-    | const_expr '<' const_expr { $$ = new BinaryConstantExpression($1, "<" , $3); }
-    | const_expr '>' const_expr { $$ = new BinaryConstantExpression($1, ">" , $3); }
-    | const_expr LEQ const_expr { $$ = new BinaryConstantExpression($1, "<=", $3); }
-    | const_expr GEQ const_expr { $$ = new BinaryConstantExpression($1, ">=", $3); }
-    | const_expr LSHIFT const_expr { $$ = new BinaryConstantExpression($1, "<<", $3); }
-    | const_expr RSHIFT const_expr { $$ = new BinaryConstantExpression($1, ">>", $3); }
-    | const_expr '+' const_expr { $$ = new BinaryConstantExpression($1, "+" , $3); }
-    | const_expr '-' const_expr { $$ = new BinaryConstantExpression($1, "-" , $3); }
-    | const_expr '*' const_expr { $$ = new BinaryConstantExpression($1, "*" , $3); }
-    | const_expr '/' const_expr { $$ = new BinaryConstantExpression($1, "/" , $3); }
-    | const_expr '%' const_expr { $$ = new BinaryConstantExpression($1, "%" , $3); }
-    | '+' const_expr %prec UNARY_PLUS  { $$ = new UnaryConstantExpression("+", $2); }
-    | '-' const_expr %prec UNARY_MINUS { $$ = new UnaryConstantExpression("-", $2); }
-    | '!' const_expr { $$ = new UnaryConstantExpression("!", $2); }
-    | '~' const_expr { $$ = new UnaryConstantExpression("~", $2); }
+          $$ = make<TernaryConstantExpression>(ast, $1, $3, $5);
+      }
+    | const_expr LOGICAL_OR const_expr  { $$ = make<BinaryConstantExpression>(ast, $1, "||", $3); }
+    | const_expr LOGICAL_AND const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "&&", $3); }
+    | const_expr '|' const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "|" , $3); }
+    | const_expr '^' const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "^" , $3); }
+    | const_expr '&' const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "&" , $3); }
+    | const_expr EQUALITY const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "==", $3); }
+    | const_expr NEQ const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "!=", $3); }
+    | const_expr '<' const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "<" , $3); }
+    | const_expr '>' const_expr { $$ = make<BinaryConstantExpression>(ast, $1, ">" , $3); }
+    | const_expr LEQ const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "<=", $3); }
+    | const_expr GEQ const_expr { $$ = make<BinaryConstantExpression>(ast, $1, ">=", $3); }
+    | const_expr LSHIFT const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "<<", $3); }
+    | const_expr RSHIFT const_expr { $$ = make<BinaryConstantExpression>(ast, $1, ">>", $3); }
+    | const_expr '+' const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "+" , $3); }
+    | const_expr '-' const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "-" , $3); }
+    | const_expr '*' const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "*" , $3); }
+    | const_expr '/' const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "/" , $3); }
+    | const_expr '%' const_expr { $$ = make<BinaryConstantExpression>(ast, $1, "%" , $3); }
+    | '+' const_expr %prec UNARY_PLUS  { $$ = make<UnaryConstantExpression>(ast, "+", $2); }
+    | '-' const_expr %prec UNARY_MINUS { $$ = make<UnaryConstantExpression>(ast, "-", $2); }
+    | '!' const_expr { $$ = make<UnaryConstantExpression>(ast, "!", $2); }
+    | '~' const_expr { $$ = make<UnaryConstantExpression>(ast, "~", $2); }
     | '(' const_expr ')' { $$ = $2; }
     | '(' error ')'
       {
         ast->addSyntaxError();
         // to avoid segfaults
-        $$ = ConstantExpression::Zero(ScalarType::KIND_INT32).release();
+        $$ = ast->getArena()->adopt(ConstantExpression::Zero(ScalarType::KIND_INT32).release());
       }
     ;
 
@@ -797,21 +802,21 @@ method_declaration
     : error_stmt { $$ = nullptr; }
     | opt_annotations valid_identifier '(' typed_vars ')' require_semicolon
       {
-          $$ = new Method($2 /* name */,
-                          $4 /* args */,
-                          new std::vector<NamedReference<Type>*> /* results */,
-                          false /* oneway */,
-                          $1 /* annotations */,
-                          convertYYLoc(@$));
+          $$ = make<Method>(ast, $2 /* name */,
+                            $4 /* args */,
+                            make<std::vector<NamedReference<Type>*>>(ast) /* results */,
+                            false /* oneway */,
+                            $1 /* annotations */,
+                            convertYYLoc(@$));
       }
     | opt_annotations ONEWAY valid_identifier '(' typed_vars ')' require_semicolon
       {
-          $$ = new Method($3 /* name */,
-                          $5 /* args */,
-                          new std::vector<NamedReference<Type>*> /* results */,
-                          true /* oneway */,
-                          $1 /* annotations */,
-                          convertYYLoc(@$));
+          $$ = make<Method>(ast, $3 /* name */,
+                            $5 /* args */,
+                            make<std::vector<NamedReference<Type>*>>(ast) /* results */,
+                            true /* oneway */,
+                            $1 /* annotations */,
+                            convertYYLoc(@$));
       }
     | opt_annotations valid_identifier '(' typed_vars ')' GENERATES '(' typed_vars ')' require_semicolon
       {
@@ -820,23 +825,23 @@ method_declaration
               ast->addSyntaxError();
           }
 
-          $$ = new Method($2 /* name */,
-                          $4 /* args */,
-                          $8 /* results */,
-                          false /* oneway */,
-                          $1 /* annotations */,
-                          convertYYLoc(@$));
+          $$ = make<Method>(ast, $2 /* name */,
+                            $4 /* args */,
+                            $8 /* results */,
+                            false /* oneway */,
+                            $1 /* annotations */,
+                            convertYYLoc(@$));
       }
     ;
 
 typed_vars
     : /* empty */
       {
-          $$ = new TypedVarVector();
+          $$ = make<TypedVarVector>(ast);
       }
     | typed_var
       {
-          $$ = new TypedVarVector();
+          $$ = make<TypedVarVector>(ast);
           if (!$$->add($1)) {
               std::cerr << "ERROR: duplicated argument or result name "
                   << $1->name() << " at " << @1 << "\n";
@@ -857,11 +862,11 @@ typed_vars
 typed_var
     : type valid_identifier
       {
-          $$ = new NamedReference<Type>($2, *$1, convertYYLoc(@2));
+          $$ = make<NamedReference<Type>>(ast, $2, *$1, convertYYLoc(@2));
       }
     | type
       {
-          $$ = new NamedReference<Type>("", *$1, convertYYLoc(@1));
+          $$ = make<NamedReference<Type>>(ast, "", *$1, convertYYLoc(@1));
 
           const std::string typeName = $$->isResolved()
               ? $$->get()->typeName() : $$->getLookupFqName().string();
@@ -881,7 +886,7 @@ struct_or_union_keyword
 named_struct_or_union_declaration
     : struct_or_union_keyword valid_type_name
       {
-          CompoundType *container = new CompoundType(
+          CompoundType *container = make<CompoundType>(ast,
               $1, $2, ast->makeFullName($2, *scope), convertYYLoc(@2), *scope);
           enterScope(ast, scope, container);
       }
@@ -902,7 +907,7 @@ struct_or_union_body
     ;
 
 field_declarations
-    : /* empty */ { $$ = new std::vector<NamedReference<Type>*>; }
+    : /* empty */ { $$ = make<std::vector<NamedReference<Type>*>>(ast); }
     | field_declarations commentable_field_declaration
       {
           $$ = $1;
@@ -935,7 +940,7 @@ field_declaration
                         << @2 << "\n";
               YYERROR;
           }
-          $$ = new NamedReference<Type>($2, *$1, convertYYLoc(@2));
+          $$ = make<NamedReference<Type>>(ast, $2, *$1, convertYYLoc(@2));
       }
     | annotated_compound_declaration ';'
       {
@@ -987,11 +992,11 @@ named_enum_declaration
               std::cerr << "ERROR: Must explicitly specify enum storage type for "
                         << $2 << " at " << @2 << "\n";
               ast->addSyntaxError();
-              storageType = new Reference<Type>(
-                  new ScalarType(ScalarType::KIND_INT64, *scope), convertYYLoc(@2));
+              storageType = make<Reference<Type>>(ast,
+                  make<ScalarType>(ast, ScalarType::KIND_INT64, *scope), convertYYLoc(@2));
           }
 
-          EnumType* enumType = new EnumType(
+          EnumType* enumType = make<EnumType>(ast,
               $2, ast->makeFullName($2, *scope), convertYYLoc(@2), *storageType, *scope);
           enterScope(ast, scope, enumType);
       }
@@ -1022,11 +1027,11 @@ commentable_enum_value
 enum_value
     : valid_identifier
       {
-          $$ = new EnumValue($1 /* name */, nullptr /* value */, convertYYLoc(@$));
+          $$ = make<EnumValue>(ast, $1 /* name */, nullptr /* value */, convertYYLoc(@$));
       }
     | valid_identifier '=' const_expr
       {
-          $$ = new EnumValue($1 /* name */, $3 /* value */, convertYYLoc(@$));
+          $$ = make<EnumValue>(ast, $1 /* name */, $3 /* value */, convertYYLoc(@$));
       }
     ;
 
@@ -1064,20 +1069,20 @@ array_type_base
     | TEMPLATED '<' type '>'
       {
           $1->setElementType(*$3);
-          $$ = new Reference<Type>($1, convertYYLoc(@1));
+          $$ = make<Reference<Type>>(ast, $1, convertYYLoc(@1));
       }
     | TEMPLATED '<' TEMPLATED '<' type RSHIFT
       {
           $3->setElementType(*$5);
           $1->setElementType(Reference<Type>($3, convertYYLoc(@3)));
-          $$ = new Reference<Type>($1, convertYYLoc(@1));
+          $$ = make<Reference<Type>>(ast, $1, convertYYLoc(@1));
       }
     ;
 
 array_type
     : array_type_base '[' const_expr ']'
       {
-          $$ = new ArrayType(*$1, $3, *scope);
+          $$ = make<ArrayType>(ast, *$1, $3, *scope);
       }
     | array_type '[' const_expr ']'
       {
@@ -1088,11 +1093,11 @@ array_type
 
 type
     : array_type_base { $$ = $1; }
-    | array_type { $$ = new Reference<Type>($1, convertYYLoc(@1)); }
+    | array_type { $$ = make<Reference<Type>>(ast, $1, convertYYLoc(@1)); }
     | INTERFACE
       {
           // "interface" is a synonym of android.hidl.base@1.0::IBase
-          $$ = new Reference<Type>(gIBaseFqName, convertYYLoc(@1));
+          $$ = make<Reference<Type>>(ast, gIBaseFqName, convertYYLoc(@1));
       }
     ;
 
@@ -1100,7 +1105,7 @@ type_or_inplace_compound_declaration
     : type { $$ = $1; }
     | annotated_compound_declaration
       {
-          $$ = new Reference<Type>($1, convertYYLoc(@1));
+          $$ = make<Reference<Type>>(ast, $1, convertYYLoc(@1));
       }
     ;
 
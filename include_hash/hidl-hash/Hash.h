@@ -27,8 +27,15 @@ struct Hash {
 
     // path to .hal file
     static const Hash &getHash(const std::string &path);
+    // Same as getHash, but if path hasn't been hashed yet, hashes content
+    // (the file's contents already read by the caller) instead of reading it.
+    static const Hash& getHash(const std::string& path, const std::string& content);
     static void clearHash(const std::string& path);
 
+    // Hashes the files at paths which haven't been hashed yet, on up to
+    // threads threads, so that getHash() finds them afterwards.
+    static void hashFiles(const std::vector<std::string>& paths, size_t threads);
+
     // returns matching hashes of interfaceName in path
     // path is something like hardware/interfaces/current.txt
     // interfaceName is something like android.hardware.foo@1.0::IFoo
@@ -36,6 +43,8 @@ struct Hash {
                                                const std::string& interfaceName, std::string* err,
                                                bool* fileExists = nullptr);
 
+    static std::vector<uint8_t> sha256(const std::string& content);
+
     static std::string hexString(const std::vector<uint8_t> &hash);
     std::string hexString() const;
 
@@ -44,8 +53,9 @@ struct Hash {
 
 private:
     Hash(const std::string &path);
+    Hash(const std::string& path, const std::string& content);
 
-    static Hash& getMutableHash(const std::string& path);
+    static Hash& getMutableHash(const std::string& path, const std::string* content = nullptr);
 
     const std::string mPath;
     std::vector<uint8_t> mHash;
@@ -18,7 +18,9 @@
 #include "Coordinator.h"
 #include "Scope.h"
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
+#include <android-base/parseint.h>
 #include <hidl-hash/Hash.h>
 #include <hidl-util/FQName.h>
 #include <hidl-util/Formatter.h>
@@ -26,9 +28,12 @@
 #include <stdio.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <chrono>
 #include <iostream>
+#include <map>
 #include <set>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 using namespace android;
@@ -128,6 +133,13 @@ struct OutputHandler {
     ValidationFunction mValidate;                   // if a given fqName is allowed for this option
     std::vector<FileGenerator> mGenerateFunctions;  // run for each target at this granularity
 
+    // If set, called once with all of the given packages (or all packages
+    // under the package roots if none are given) instead of generating
+    // each target.
+    using PackagesFunction = std::function<status_t(const std::vector<FQName>& packages,
+                                                    const Coordinator* coordinator)>;
+    PackagesFunction mPackagesFunction = nullptr;
+
     const std::string& name() const { return mKey; }
     const std::string& description() const { return mDescription; }
 
@@ -137,6 +149,11 @@ struct OutputHandler {
         return mValidate(fqName, coordinator, language);
     }
 
+    // Same as generate, but outputs are copied from cacheDir if they were
+    // generated from the same inputs before, and are added to it otherwise.
+    status_t generateCached(const FQName& fqName, const Coordinator* coordinator,
+                            const std::string& cacheDir) const;
+
     status_t writeDepFile(const FQName& fqName, const Coordinator* coordinator) const;
 
    private:
@@ -222,6 +239,106 @@ status_t OutputHandler::generate(const FQName& fqName, const Coordinator* coordi
     return OK;
 }
 
+// Copies the outputs cached in entry to the output directory, and sets
+// outputFiles to them. Files are hard linked where possible.
+static bool restoreCachedOutputs(const std::string& entry, const Coordinator* coordinator,
+                                 std::vector<std::string>* outputFiles) {
+    // The list of outputs is written last, so entries without it are
+    // incomplete. Outputs only depend on what the key is computed from, so
+    // the list is not computed again (which may need to parse files).
+    std::string manifest;
+    if (!base::ReadFileToString(entry + "outputs", &manifest)) return false;
+
+    std::vector<std::string> relativePaths;
+    StringHelper::SplitString(manifest, '\n', &relativePaths);
+    for (const std::string& relativePath : relativePaths) {
+        if (relativePath.empty()) continue;
+
+        const std::string outputFile = coordinator->getOutputPath() + relativePath;
+        const std::string cached = entry + relativePath;
+
+        if (!Coordinator::MakeParentHierarchy(outputFile)) return false;
+        unlink(outputFile.c_str());
+        if (link(cached.c_str(), outputFile.c_str()) != 0) {
+            std::string content;
+            if (!base::ReadFileToString(cached, &content) ||
+                !base::WriteStringToFile(content, outputFile)) {
+                return false;
+            }
+        }
+        outputFiles->push_back(outputFile);
+    }
+
+    return true;
+}
+
+// Copies outputFiles into entry. Each file is written under a temporary name
+// and renamed, so concurrent hidl-gen invocations never see partial files.
+static bool storeCachedOutputs(const std::string& entry,
+                               const std::vector<std::string>& outputFiles,
+                               const Coordinator* coordinator) {
+    const std::string suffix = ".tmp." + std::to_string(getpid());
+
+    const auto store = [&](const std::string& path, const std::string& content) {
+        return Coordinator::MakeParentHierarchy(path) &&
+               base::WriteStringToFile(content, path + suffix) &&
+               rename((path + suffix).c_str(), path.c_str()) == 0;
+    };
+
+    std::string manifest;
+    for (const std::string& outputFile : outputFiles) {
+        const std::string relativePath =
+            StringHelper::LTrim(outputFile, coordinator->getOutputPath());
+
+        std::string content;
+        if (!base::ReadFileToString(outputFile, &content) ||
+            !store(entry + relativePath, content)) {
+            return false;
+        }
+        manifest += relativePath + "\n";
+    }
+
+    return store(entry + "outputs", manifest);
+}
+
+status_t OutputHandler::generateCached(const FQName& fqName, const Coordinator* coordinator,
+                                       const std::string& cacheDir) const {
+    // Nothing to cache for output to standard out.
+    if (mLocation == Coordinator::Location::STANDARD_OUT) return generate(fqName, coordinator);
+
+    std::string key;
+    std::vector<std::string> inputs;
+    if (coordinator->getOutputCacheKey(fqName, name(), &key, &inputs) != OK) {
+        // Errors are reported by generate().
+        return generate(fqName, coordinator);
+    }
+
+    const std::string entry = cacheDir + key.substr(0, 2) + "/" + key + "/";
+
+    std::vector<std::string> outputFiles;
+    if (restoreCachedOutputs(entry, coordinator, &outputFiles)) {
+        if (coordinator->isVerbose()) {
+            fprintf(stderr, "VERBOSE: using cached outputs %s\n", entry.c_str());
+        }
+        coordinator->addOutputDependencies(outputFiles, inputs);
+        return OK;
+    }
+
+    status_t err = generate(fqName, coordinator);
+    if (err != OK) return err;
+
+    outputFiles.clear();
+    err = appendOutputFiles(fqName, coordinator, &outputFiles);
+    if (err != OK) return err;
+
+    if (!storeCachedOutputs(entry, outputFiles, coordinator)) {
+        fprintf(stderr, "WARNING: could not add outputs for %s to %s.\n",
+                fqName.string().c_str(), cacheDir.c_str());
+    }
+
+    return OK;
+}
+
 status_t OutputHandler::appendOutputFiles(const FQName& fqName, const Coordinator* coordinator,
                                           std::vector<std::string>* outputFiles) const {
     std::vector<FQName> targets;
@@ -248,11 +365,7 @@ status_t OutputHandler::writeDepFile(const FQName& fqName, const Coordinator* co
         return OK;
     }
 
-    // Depfiles in Android for genrules should be for the 'main file'. Because hidl-gen doesn't have
-    // a main file for most targets, we are just outputting a depfile for one single file only.
-    const std::string forFile = outputFiles[0];
-
-    return coordinator->writeDepFile(forFile);
+    return coordinator->writeDepFile(outputFiles);
 }
 
 // Use an AST function as a OutputHandler GenerationFunction
@@ -358,7 +471,8 @@ static status_t isPackageJavaCompatible(const FQName& packageFQName, const Coord
         const FQName fqName = todo.back();
         todo.pop_back();
 
-        AST *ast = coordinator->parse(fqName);
+        // Restrictions are enforced when packages are generated, not here.
+        AST* ast = coordinator->parse(fqName, nullptr /* parsedASTs */, Coordinator::Enforce::NONE);
 
         if (ast == nullptr) {
             return UNKNOWN_ERROR;
@@ -562,6 +676,8 @@ static status_t generateAndroidBpForPackage(Formatter& out, const FQName& packag
             typesAST = ast;
         }
 
+        err = ast->parseAllLazilyImportedFiles();
+        if (err != OK) return err;
         ast->getImportedPackagesHierarchy(&importedPackagesHierarchy);
         ast->appendToExportedTypesVector(&exportedTypes);
     }
@@ -971,6 +1087,15 @@ static const std::vector<FileGenerator> kCppAdapterSourceFormats = {
     },
 };
 
+static status_t checkPackages(const std::vector<FQName>& packages,
+                              const Coordinator* coordinator);
+static status_t printDependencies(const std::vector<FQName>& packages,
+                                  const Coordinator* coordinator);
+static status_t printUnreferencedTypes(const std::vector<FQName>& packages,
+                                       const Coordinator* coordinator);
+static status_t auditHashes(const std::vector<FQName>& packages, const Coordinator* coordinator,
+                            bool json);
+
 static const std::vector<OutputHandler> kFormats = {
     {
         "check",
@@ -987,6 +1112,60 @@ static const std::vector<OutputHandler> kFormats = {
             },
         },
     },
+    {
+        "check-all",
+        "Parses and enforces restrictions on the given packages, or on all packages under the package roots if none are given, and prints a JSON summary. Doesn't write any files.",
+        OutputMode::NOT_NEEDED,
+        Coordinator::Location::STANDARD_OUT,
+        GenerationGranularity::PER_PACKAGE,
+        validateIsPackage,
+        {},
+        checkPackages,
+    },
+    {
+        "deps",
+        "Prints, as JSON, the packages each of the given packages (or of all packages under the package roots if none are given) imports, directly and transitively, and which of the given packages import it.",
+        OutputMode::NOT_NEEDED,
+        Coordinator::Location::STANDARD_OUT,
+        GenerationGranularity::PER_PACKAGE,
+        validateIsPackage,
+        {},
+        printDependencies,
+    },
+    {
+        "unreferenced",
+        "Prints, as JSON, the types each of the given packages (or of all packages under the package roots if none are given) defines or imports without referencing them, and which of the defined ones no given package references.",
+        OutputMode::NOT_NEEDED,
+        Coordinator::Location::STANDARD_OUT,
+        GenerationGranularity::PER_PACKAGE,
+        validateIsPackage,
+        {},
+        printUnreferencedTypes,
+    },
+    {
+        "freeze-audit",
+        "Hashes every interface of the given packages, or of all packages under the package roots if none are given, and prints its status against current.txt and frozen interfaces depending on unfrozen ones.",
+        OutputMode::NOT_NEEDED,
+        Coordinator::Location::STANDARD_OUT,
+        GenerationGranularity::PER_PACKAGE,
+        validateIsPackage,
+        {},
+        [](const std::vector<FQName>& packages, const Coordinator* coordinator) {
+            return auditHashes(packages, coordinator, false /* json */);
+        },
+    },
+    {
+        "freeze-audit-json",
+        "Same as freeze-audit, but prints JSON.",
+        OutputMode::NOT_NEEDED,
+        Coordinator::Location::STANDARD_OUT,
+        GenerationGranularity::PER_PACKAGE,
+        validateIsPackage,
+        {},
+        [](const std::vector<FQName>& packages, const Coordinator* coordinator) {
+            return auditHashes(packages, coordinator, true /* json */);
+        },
+    },
     {
         "c++",
         "(internal) (deprecated) Generates C++ interface files for talking to HIDL interfaces.",
@@ -1086,6 +1265,61 @@ static const std::vector<OutputHandler> kFormats = {
         validateIsPackage,
         {singleFileGenerator("main.cpp", generateAdapterMainSource)},
     },
+    {
+        "c++-bench",
+        "Generates a Google benchmark binary per interface, which measures calls to a trivial implementation passthrough, binderized within the process and binderized across processes.",
+        OutputMode::NEEDS_DIR,
+        Coordinator::Location::GEN_OUTPUT,
+        GenerationGranularity::PER_FILE,
+        validateForSource,
+        {
+            {
+                FileGenerator::generateForInterfaces,
+                [](const FQName& fqName) { return fqName.name() + "Benchmark.cpp"; },
+                astGenerationFunction(&AST::generateCppBenchmarkSource),
+            },
+        }
+    },
+    {
+        "c++-fuzzer",
+        "Generates a libFuzzer target per interface, which calls its passthrough implementation through the hwbinder proxy and stub.",
+        OutputMode::NEEDS_DIR,
+        Coordinator::Location::GEN_OUTPUT,
+        GenerationGranularity::PER_FILE,
+        validateForSource,
+        {
+            {
+                FileGenerator::generateForInterfaces,
+                [](const FQName& fqName) { return fqName.getInterfaceBaseName() + "Fuzzer.cpp"; },
+                astGenerationFunction(&AST::generateCppFuzzerSource),
+            },
+        }
+    },
+    {
+        "c++-recorder",
+        "Generates a proxy per interface that records calls to a log, and a binary that replays such a log against a service.",
+        OutputMode::NEEDS_DIR,
+        Coordinator::Location::GEN_OUTPUT,
+        GenerationGranularity::PER_FILE,
+        validateForSource,
+        {
+            {
+                FileGenerator::generateForInterfaces,
+                [](const FQName& fqName) { return fqName.name() + "Recorder.h"; },
+                astGenerationFunction(&AST::generateCppRecorderHeader),
+            },
+            {
+                FileGenerator::generateForInterfaces,
+                [](const FQName& fqName) { return fqName.name() + "Recorder.cpp"; },
+                astGenerationFunction(&AST::generateCppRecorderSource),
+            },
+            {
+                FileGenerator::generateForInterfaces,
+                [](const FQName& fqName) { return fqName.name() + "Replayer.cpp"; },
+                astGenerationFunction(&AST::generateCppReplayerSource),
+            },
+        }
+    },
     {
         "java",
         "(internal) Generates Java library for talking to HIDL interfaces in Java.",
@@ -1143,7 +1377,7 @@ static const std::vector<OutputHandler> kFormats = {
     },
     {
         "androidbp",
-        "(internal) Generates Soong bp files for -Lc++-headers, -Lc++-sources, -Ljava, -Ljava-constants, and -Lc++-adapter.",
+        "(internal) Generates Soong bp files for -Lc++-headers, -Lc++-sources, -Ljava, -Ljava-constants, and -Lc++-adapter. A package root (e.x. android.hardware) given instead of a package stands for every package under it.",
         OutputMode::NEEDS_SRC,
         Coordinator::Location::PACKAGE_ROOT,
         GenerationGranularity::PER_PACKAGE,
@@ -1177,10 +1411,355 @@ static const std::vector<OutputHandler> kFormats = {
 };
 // clang-format on
 
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// -Lcheck-all: rather than going through generate() for each package, all
+// files of all packages are parsed up front (in parallel with -j), and then
+// each package is checked in turn. Unlike -Lcheck, it doesn't stop at the
+// first package with errors.
+static status_t checkPackages(const std::vector<FQName>& packages,
+                              const Coordinator* coordinator) {
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<FQName> allInterfaces;
+    for (const FQName& package : packages) {
+        std::vector<FQName> packageInterfaces;
+        status_t err = coordinator->appendPackageInterfacesToVector(package, &packageInterfaces);
+        if (err != OK) return err;
+        allInterfaces.insert(allInterfaces.end(), packageInterfaces.begin(),
+                             packageInterfaces.end());
+    }
+
+    coordinator->prefetch(allInterfaces);
+    const double parseMs = millisecondsSince(start);
+
+    Formatter out(stdout);
+    bool allPassed = true;
+
+    out << "{\n";
+    out.indent();
+    out << "\"parseMs\": " << std::to_string(parseMs) << ",\n";
+    out << "\"packages\": [\n";
+    out.indent();
+
+    for (size_t i = 0; i < packages.size(); i++) {
+        const FQName& package = packages[i];
+
+        std::vector<FQName> packageInterfaces;
+        status_t err = coordinator->appendPackageInterfacesToVector(package, &packageInterfaces);
+
+        // Files which failed to parse above are not parsed again.
+        for (const FQName& fqName : packageInterfaces) {
+            if (err != OK) break;
+            if (coordinator->parse(fqName, nullptr /* parsedASTs */,
+                                   Coordinator::Enforce::NONE) == nullptr) {
+                fprintf(stderr, "ERROR: Could not parse %s.\n", fqName.string().c_str());
+                err = UNKNOWN_ERROR;
+            }
+        }
+        if (err == OK) {
+            err = coordinator->enforceRestrictionsOnPackage(package);
+        }
+
+        allPassed = allPassed && err == OK;
+
+        out << "{\"package\": \"" << package.string() << "\", \"status\": \""
+            << (err == OK ? "ok" : "error") << "\", \"files\": "
+            << std::to_string(packageInterfaces.size()) << "}"
+            << (i + 1 < packages.size() ? "," : "") << "\n";
+    }
+
+    out.unindent();
+    out << "],\n";
+    out << "\"totalMs\": " << std::to_string(millisecondsSince(start)) << "\n";
+    out.unindent();
+    out << "}\n";
+
+    return allPassed ? OK : UNKNOWN_ERROR;
+}
+
+// Packages imported by the files of package, other than package itself.
+static status_t getImportedPackages(const FQName& package, const Coordinator* coordinator,
+                                    std::set<FQName>* imported) {
+    std::vector<FQName> packageInterfaces;
+    status_t err = coordinator->appendPackageInterfacesToVector(package, &packageInterfaces);
+    if (err != OK) return err;
+
+    for (const FQName& fqName : packageInterfaces) {
+        AST* ast = coordinator->parse(fqName, nullptr /* parsedASTs */, Coordinator::Enforce::NONE);
+        if (ast == nullptr) {
+            fprintf(stderr, "ERROR: Could not parse %s. Aborting.\n", fqName.string().c_str());
+            return UNKNOWN_ERROR;
+        }
+        ast->getImportedPackages(imported);
+    }
+
+    return OK;
+}
+
+static void printNameList(Formatter& out, const std::string& key, const std::set<FQName>& names,
+                          bool last = false) {
+    out << "\"" << key << "\": [";
+    bool first = true;
+    for (const FQName& name : names) {
+        out << (first ? "" : ", ") << "\"" << name.string() << "\"";
+        first = false;
+    }
+    out << "]" << (last ? "" : ", ");
+}
+
+// -Ldeps: the import graph of packages, from one parse of every package
+// they transitively import. For each package, prints the packages it
+// imports ("imports") and transitively depends on ("closure"), and the
+// packages given which import it ("importedBy") or transitively depend on
+// it ("dependents").
+static status_t printDependencies(const std::vector<FQName>& packages,
+                                  const Coordinator* coordinator) {
+    std::vector<FQName> allInterfaces;
+    for (const FQName& package : packages) {
+        std::vector<FQName> packageInterfaces;
+        status_t err = coordinator->appendPackageInterfacesToVector(package, &packageInterfaces);
+        if (err != OK) return err;
+        allInterfaces.insert(allInterfaces.end(), packageInterfaces.begin(),
+                             packageInterfaces.end());
+    }
+
+    // Parses the files which don't depend on each other in parallel with -j.
+    coordinator->prefetch(allInterfaces);
+
+    // Direct imports of every package reachable from packages.
+    std::map<FQName, std::set<FQName>> imports;
+    std::vector<FQName> toVisit = packages;
+    while (!toVisit.empty()) {
+        const FQName package = toVisit.back();
+        toVisit.pop_back();
+        if (imports.find(package) != imports.end()) continue;
+
+        status_t err = getImportedPackages(package, coordinator, &imports[package]);
+        if (err != OK) return err;
+        toVisit.insert(toVisit.end(), imports[package].begin(), imports[package].end());
+    }
+
+    std::map<FQName, std::set<FQName>> closures;
+    for (const FQName& package : packages) {
+        std::set<FQName>& closure = closures[package];
+        std::vector<FQName> toClose(imports[package].begin(), imports[package].end());
+        while (!toClose.empty()) {
+            const FQName next = toClose.back();
+            toClose.pop_back();
+            if (!closure.insert(next).second) continue;
+            toClose.insert(toClose.end(), imports[next].begin(), imports[next].end());
+        }
+    }
+
+    std::map<FQName, std::set<FQName>> importedBy;
+    std::map<FQName, std::set<FQName>> dependents;
+    for (const FQName& package : packages) {
+        for (const FQName& imported : imports[package]) {
+            importedBy[imported].insert(package);
+        }
+        for (const FQName& dependency : closures[package]) {
+            dependents[dependency].insert(package);
+        }
+    }
+
+    Formatter out(stdout);
+    out << "{\n";
+    out.indent();
+    out << "\"packages\": [\n";
+    out.indent();
+
+    for (size_t i = 0; i < packages.size(); i++) {
+        const FQName& package = packages[i];
+
+        out << "{\"package\": \"" << package.string() << "\", ";
+        printNameList(out, "imports", imports[package]);
+        printNameList(out, "closure", closures[package]);
+        printNameList(out, "importedBy", importedBy[package]);
+        printNameList(out, "dependents", dependents[package], true /* last */);
+        out << "}" << (i + 1 < packages.size() ? "," : "") << "\n";
+    }
+
+    out.unindent();
+    out << "]\n";
+    out.unindent();
+    out << "}\n";
+
+    return OK;
+}
+
+// -Lunreferenced: the -v report of dumpDefinedButUnreferencedTypeNames for
+// many packages at once, from one (parallel with -j) parse of all of them.
+// Types a package defines but doesn't reference may still be used by other
+// packages, so those which no given package references are listed apart
+// ("unusedDefinitions").
+static status_t printUnreferencedTypes(const std::vector<FQName>& packages,
+                                       const Coordinator* coordinator) {
+    std::map<FQName, std::vector<FQName>> packageInterfaces;
+    std::map<FQName, status_t> packageStatus;
+    std::vector<FQName> allInterfaces;
+    for (const FQName& package : packages) {
+        packageStatus[package] =
+            coordinator->appendPackageInterfacesToVector(package, &packageInterfaces[package]);
+        allInterfaces.insert(allInterfaces.end(), packageInterfaces[package].begin(),
+                             packageInterfaces[package].end());
+    }
+
+    coordinator->prefetch(allInterfaces);
+
+    std::map<FQName, std::set<FQName>> unreferencedDefinitions;
+    std::map<FQName, std::set<FQName>> unreferencedImports;
+    std::unordered_set<std::string> referenced;  // by any of packages
+    bool allPassed = true;
+    for (const FQName& package : packages) {
+        // A package which fails to parse is reported as such, rather than
+        // failing the report of every other package.
+        status_t& err = packageStatus[package];
+        if (err == OK) {
+            err = coordinator->addUnreferencedTypes(
+                packageInterfaces[package], &unreferencedDefinitions[package],
+                &unreferencedImports[package], Coordinator::Enforce::NONE);
+        }
+
+        for (const FQName& fqName : packageInterfaces[package]) {
+            if (err != OK) break;
+
+            AST* ast = coordinator->parse(fqName, nullptr /* parsedASTs */,
+                                          Coordinator::Enforce::NONE);
+            if (ast == nullptr) {
+                fprintf(stderr, "ERROR: Could not parse %s.\n", fqName.string().c_str());
+                err = UNKNOWN_ERROR;
+                break;
+            }
+
+            std::set<FQName> referencedTypes;
+            ast->addReferencedTypes(&referencedTypes);
+            for (const FQName& name : referencedTypes) {
+                referenced.insert(name.string());
+            }
+        }
+
+        allPassed = allPassed && err == OK;
+    }
+
+    Formatter out(stdout);
+    out << "{\n";
+    out.indent();
+    out << "\"packages\": [\n";
+    out.indent();
+
+    for (size_t i = 0; i < packages.size(); i++) {
+        const FQName& package = packages[i];
+
+        out << "{\"package\": \"" << package.string() << "\", \"status\": \""
+            << (packageStatus[package] == OK ? "ok" : "error") << "\"";
+        if (packageStatus[package] == OK) {
+            std::set<FQName> unusedDefinitions;
+            for (const FQName& name : unreferencedDefinitions[package]) {
+                if (referenced.count(name.string()) == 0) unusedDefinitions.insert(name);
+            }
+
+            out << ", ";
+            printNameList(out, "unreferencedDefinitions", unreferencedDefinitions[package]);
+            printNameList(out, "unusedDefinitions", unusedDefinitions);
+            printNameList(out, "unreferencedImports", unreferencedImports[package],
+                          true /* last */);
+        }
+        out << "}" << (i + 1 < packages.size() ? "," : "") << "\n";
+    }
+
+    out.unindent();
+    out << "]\n";
+    out.unindent();
+    out << "}\n";
+
+    return allPassed ? OK : UNKNOWN_ERROR;
+}
+
+static const char* hashStatusName(Coordinator::HashStatus status) {
+    switch (status) {
+        case Coordinator::HashStatus::ERROR:
+            return "error";
+        case Coordinator::HashStatus::UNFROZEN:
+            return "unfrozen";
+        case Coordinator::HashStatus::FROZEN:
+            return "frozen";
+        case Coordinator::HashStatus::CHANGED:
+            return "changed";
+    }
+    CHECK(false) << "Unknown hash status";
+    return nullptr;
+}
+
+// -Lfreeze-audit(-json): hashes every interface of packages at once and
+// reports each one's status. Fails if any interface changed, couldn't be
+// checked, or is frozen but depends on unfrozen interfaces.
+static status_t auditHashes(const std::vector<FQName>& packages, const Coordinator* coordinator,
+                            bool json) {
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<Coordinator::HashAuditEntry> entries;
+    status_t err = coordinator->auditHashes(packages, &entries);
+    if (err != OK) return err;
+
+    bool passed = true;
+    for (const auto& entry : entries) {
+        passed = passed && (entry.status == Coordinator::HashStatus::FROZEN ||
+                            entry.status == Coordinator::HashStatus::UNFROZEN) &&
+                 entry.unfrozenDependencies.empty();
+    }
+
+    Formatter out(stdout);
+
+    if (!json) {
+        for (const auto& entry : entries) {
+            out << hashStatusName(entry.status) << " " << entry.hash << " "
+                << entry.fqName.string() << "\n";
+            for (const FQName& name : entry.unfrozenDependencies) {
+                out.indent(2, [&] {
+                    out << "depends on unfrozen " << name.string() << "\n";
+                });
+            }
+        }
+        return passed ? OK : UNKNOWN_ERROR;
+    }
+
+    out << "{\n";
+    out.indent();
+    out << "\"interfaces\": [\n";
+    out.indent();
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        const auto& entry = entries[i];
+
+        out << "{\"fqName\": \"" << entry.fqName.string() << "\", \"hash\": \"" << entry.hash
+            << "\", \"status\": \"" << hashStatusName(entry.status)
+            << "\", \"unfrozenDependencies\": [";
+        bool first = true;
+        for (const FQName& name : entry.unfrozenDependencies) {
+            out << (first ? "" : ", ") << "\"" << name.string() << "\"";
+            first = false;
+        }
+        out << "]}" << (i + 1 < entries.size() ? "," : "") << "\n";
+    }
+
+    out.unindent();
+    out << "],\n";
+    out << "\"passed\": " << (passed ? "true" : "false") << ",\n";
+    out << "\"totalMs\": " << std::to_string(millisecondsSince(start)) << "\n";
+    out.unindent();
+    out << "}\n";
+
+    return passed ? OK : UNKNOWN_ERROR;
+}
+
 static void usage(const char *me) {
     fprintf(stderr,
-            "usage: %s [-p <root path>] -o <output path> -L <language> [-O <owner>] (-r <interface "
-            "root>)+ [-v] [-d <depfile>] FQNAME...\n\n",
+            "usage: %s [-p <root path>] (-o <output path> | -a <archive>) -L <language> [-O <owner>] (-r <interface "
+            "root>)+ [-v] [-d <depfile>] [-D <depdir>] [-j <threads>] FQNAME...\n\n",
             me);
 
     fprintf(stderr,
@@ -1193,10 +1772,19 @@ static void usage(const char *me) {
     }
     fprintf(stderr, "         -O <owner>: The owner of the module for -Landroidbp(-impl)?.\n");
     fprintf(stderr, "         -o <output path>: Location to output files.\n");
+    fprintf(stderr, "         -a <archive>: write all outputs into a .tar, .zip, .jar or .srcjar\n");
+    fprintf(stderr, "                       archive instead of under the output path.\n");
     fprintf(stderr, "         -p <root path>: Android build root, defaults to $ANDROID_BUILD_TOP or pwd.\n");
     fprintf(stderr, "         -r <package:path root>: E.g., android.hardware:hardware/interfaces.\n");
     fprintf(stderr, "         -v: verbose output.\n");
     fprintf(stderr, "         -d <depfile>: location of depfile to write to.\n");
+    fprintf(stderr, "         -D <depdir>: also write a depfile for each output, listing only the\n");
+    fprintf(stderr, "                      files it was generated from, under this directory.\n");
+    fprintf(stderr, "         -j <threads>: parse independent imports (or, with -Lfreeze-audit,\n");
+    fprintf(stderr, "                       hash files) on this many threads.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "If HIDL_GEN_CACHE_DIR is set, generated files are reused from and added to\n");
+    fprintf(stderr, "that directory, keyed by hidl-gen itself, the options and the input files.\n");
 }
 
 // hidl is intentionally leaky. Turn off LeakSanitizer by default.
@@ -1214,9 +1802,10 @@ int main(int argc, char **argv) {
     const OutputHandler* outputFormat = nullptr;
     Coordinator coordinator;
     std::string outputPath;
+    std::string outputArchive;
 
     int res;
-    while ((res = getopt(argc, argv, "hp:o:O:r:L:vd:")) >= 0) {
+    while ((res = getopt(argc, argv, "hp:o:a:O:r:L:vd:D:j:")) >= 0) {
         switch (res) {
             case 'p': {
                 if (!coordinator.getRootPath().empty()) {
@@ -1232,11 +1821,32 @@ int main(int argc, char **argv) {
                 break;
             }
 
+            case 'a': {
+                outputArchive = optarg;
+                break;
+            }
+
             case 'd': {
                 coordinator.setDepFile(optarg);
                 break;
             }
 
+            case 'D': {
+                coordinator.setDepDir(optarg);
+                break;
+            }
+
+            case 'j': {
+                size_t threads;
+                if (!base::ParseUint(optarg, &threads) || threads == 0) {
+                    fprintf(stderr, "ERROR: -j <threads> must be a positive number: %s\n",
+                            optarg);
+                    exit(1);
+                }
+                coordinator.setParseThreads(threads);
+                break;
+            }
+
             case 'o': {
                 if (!outputPath.empty()) {
                     fprintf(stderr, "ERROR: -o <output path> can only be specified once.\n");
@@ -1315,6 +1925,15 @@ int main(int argc, char **argv) {
         }
     }
 
+    // Generated outputs are shared through this directory, see
+    // OutputHandler::generateCached().
+    std::string outputCacheDir;
+    const char* HIDL_GEN_CACHE_DIR = getenv("HIDL_GEN_CACHE_DIR");
+    if (HIDL_GEN_CACHE_DIR != nullptr && HIDL_GEN_CACHE_DIR[0] != '\0') {
+        outputCacheDir = HIDL_GEN_CACHE_DIR;
+        if (outputCacheDir.back() != '/') outputCacheDir += "/";
+    }
+
     if (outputFormat == nullptr) {
         fprintf(stderr,
             "ERROR: no -L option provided.\n");
@@ -1324,7 +1943,9 @@ int main(int argc, char **argv) {
     argc -= optind;
     argv += optind;
 
-    if (argc == 0) {
+    // -Lcheck-all, -Ldeps, -Lunreferenced and -Lfreeze-audit(-json) take all
+    // packages if none are given.
+    if (argc == 0 && outputFormat->mPackagesFunction == nullptr) {
         fprintf(stderr, "ERROR: no fqname specified.\n");
         usage(me);
         exit(1);
@@ -1335,6 +1956,11 @@ int main(int argc, char **argv) {
     switch (outputFormat->mOutputMode) {
         case OutputMode::NEEDS_DIR:
         case OutputMode::NEEDS_FILE: {
+            // With -a, outputs are named relative to the archive's root.
+            if (!outputArchive.empty() && outputFormat->mOutputMode == OutputMode::NEEDS_DIR) {
+                break;
+            }
+
             if (outputPath.empty()) {
                 usage(me);
                 exit(1);
@@ -1365,18 +1991,106 @@ int main(int argc, char **argv) {
 
     coordinator.setOutputPath(outputPath);
 
+    if (!outputArchive.empty()) {
+        if (outputFormat->mOutputMode != OutputMode::NEEDS_DIR) {
+            fprintf(stderr, "ERROR: -a is only supported for options writing to a directory.\n");
+            exit(1);
+        }
+        if (coordinator.setOutputArchive(outputArchive) != OK) exit(1);
+    }
+
     coordinator.addDefaultPackagePath("android.hardware", "hardware/interfaces");
     coordinator.addDefaultPackagePath("android.hidl", "system/libhidl/transport");
     coordinator.addDefaultPackagePath("android.frameworks", "frameworks/hardware/interfaces");
     coordinator.addDefaultPackagePath("android.system", "system/hardware/interfaces");
 
-    for (int i = 0; i < argc; ++i) {
+    if (outputFormat->mPackagesFunction != nullptr) {
+        std::vector<FQName> packages;
+        for (int i = 0; i < argc; ++i) {
+            FQName fqName;
+            if (!FQName::parse(argv[i], &fqName) ||
+                !outputFormat->validate(fqName, &coordinator, outputFormat->name())) {
+                fprintf(stderr, "ERROR: Invalid package name as argument: %s.\n", argv[i]);
+                exit(1);
+            }
+            packages.push_back(fqName);
+        }
+
+        if (packages.empty() && coordinator.appendPackagesUnderRoots(&packages) != OK) {
+            exit(1);
+        }
+
+        return outputFormat->mPackagesFunction(packages, &coordinator) == OK ? 0 : 1;
+    }
+
+    std::vector<std::string> targets(argv, argv + argc);
+
+    // -Landroidbp also takes package roots (e.x. android.hardware), which
+    // stand for every package under them, so that the build files of a
+    // whole root are regenerated in a single invocation, and imports shared
+    // between packages are only parsed once. All files are parsed up front
+    // (in parallel with -j), then each package is enforced and generated in
+    // turn, as parse() enforces cached files too.
+    bool printProgress = false;
+    if (outputFormat->name() == "androidbp") {
+        std::vector<std::string> packageTargets;
+        std::vector<FQName> allInterfaces;
+        for (const std::string& target : targets) {
+            if (target.find('@') != std::string::npos) {
+                packageTargets.push_back(target);
+                continue;
+            }
+
+            std::vector<FQName> packages;
+            if (coordinator.appendPackagesUnderRoot(target, &packages) != OK) {
+                exit(1);
+            }
+            for (const FQName& package : packages) {
+                packageTargets.push_back(package.string());
+
+                // Errors are reported when the package is generated.
+                coordinator.appendPackageInterfacesToVector(package, &allInterfaces);
+            }
+            printProgress = true;
+        }
+
+        targets = std::move(packageTargets);
+        if (printProgress) coordinator.prefetch(allInterfaces);
+    }
+
+    // -Lhash: parse all requested files up front, in parallel with -j. Each
+    // file is hashed as it is parsed.
+    if (outputFormat->name() == "hash") {
+        std::vector<FQName> fqNames;
+        for (const std::string& target : targets) {
+            FQName fqName;
+            if (!FQName::parse(target, &fqName)) continue;  // reported below
+
+            std::vector<FQName> packageInterfaces;
+            if (fqName.isFullyQualified()) {
+                packageInterfaces.push_back(fqName);
+            } else if (coordinator.appendPackageInterfacesToVector(fqName, &packageInterfaces) !=
+                       OK) {
+                continue;  // reported below
+            }
+            fqNames.insert(fqNames.end(), packageInterfaces.begin(), packageInterfaces.end());
+        }
+        coordinator.prefetch(fqNames);
+    }
+
+    for (const std::string& target : targets) {
         FQName fqName;
-        if (!FQName::parse(argv[i], &fqName)) {
-            fprintf(stderr, "ERROR: Invalid fully-qualified name as argument: %s.\n", argv[i]);
+        if (!FQName::parse(target, &fqName)) {
+            fprintf(stderr, "ERROR: Invalid fully-qualified name as argument: %s.\n",
+                    target.c_str());
             exit(1);
         }
 
+        if (printProgress) {
+            printf("Updating %s\n", target.c_str());
+            fflush(stdout);
+        }
+
         // Dump extra verbose output
         if (coordinator.isVerbose()) {
             status_t err =
@@ -1390,12 +2104,16 @@ int main(int argc, char **argv) {
             exit(1);
         }
 
-        status_t err = outputFormat->generate(fqName, &coordinator);
+        status_t err = outputCacheDir.empty() || !outputArchive.empty()
+                           ? outputFormat->generate(fqName, &coordinator)
+                           : outputFormat->generateCached(fqName, &coordinator, outputCacheDir);
         if (err != OK) exit(1);
 
         err = outputFormat->writeDepFile(fqName, &coordinator);
         if (err != OK) exit(1);
     }
 
+    if (coordinator.closeOutputArchive() != OK) exit(1);
+
     return 0;
 }
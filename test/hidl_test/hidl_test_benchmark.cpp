@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "hidl_test_benchmark"
+
+// Measures the calls of hidl_test_client that stress marshalling, against
+// the same services. Passthrough benchmarks run in this process; binderized
+// ones run when hidl_test_servers is running. Results are printed as JSON,
+// unless another --benchmark_format is given.
+
+#include <android/hardware/tests/bar/1.0/IBar.h>
+#include <android/hardware/tests/baz/1.0/IBaz.h>
+#include <android/hardware/tests/foo/1.0/IFoo.h>
+#include <android/hardware/tests/memory/1.0/IMemoryTest.h>
+#include <android/hidl/allocator/1.0/IAllocator.h>
+
+#include <benchmark/benchmark.h>
+#include <hidl/HidlTransportSupport.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+using ::android::hardware::tests::foo::V1_0::Abc;
+using ::android::hardware::tests::foo::V1_0::IFoo;
+using ::android::hardware::tests::foo::V1_0::ISimple;
+using ::android::hardware::tests::bar::V1_0::IBar;
+using ::android::hardware::tests::baz::V1_0::IBaz;
+using ::android::hardware::tests::baz::V1_0::IBazCallback;
+using ::android::hardware::tests::memory::V1_0::IMemoryTest;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::android::hardware::hidl_array;
+using ::android::hardware::hidl_memory;
+using ::android::hardware::hidl_string;
+using ::android::hardware::hidl_vec;
+using ::android::hidl::allocator::V1_0::IAllocator;
+using ::android::sp;
+
+struct Services {
+    sp<IFoo> foo;
+    sp<IBar> bar;
+    sp<IMemoryTest> memoryTest;
+    sp<IBaz> baz;
+};
+
+struct Simple : public ISimple {
+    Simple(int32_t cookie) : mCookie(cookie) {}
+
+    Return<int32_t> getCookie() override { return mCookie; }
+
+    Return<void> customVecInt(customVecInt_cb _cb) override {
+        _cb(hidl_vec<int32_t>());
+        return Void();
+    }
+
+    Return<void> customVecStr(customVecStr_cb _cb) override {
+        _cb(hidl_vec<hidl_string>());
+        return Void();
+    }
+
+    Return<void> mystr(mystr_cb _cb) override {
+        _cb(hidl_string());
+        return Void();
+    }
+
+    Return<void> myhandle(myhandle_cb _cb) override {
+        _cb(nullptr);
+        return Void();
+    }
+
+   private:
+    int32_t mCookie;
+};
+
+struct BazCallback : public IBazCallback {
+    Return<void> heyItsMe(const sp<IBazCallback>& /* cb */) override {
+        ++calls;
+        return Void();
+    }
+
+    Return<void> hey() override { return Void(); }
+
+    std::atomic<size_t> calls{0};
+};
+
+static hidl_memory gMemory;
+
+template <typename T>
+static bool checkOk(benchmark::State& state, const Return<T>& ret) {
+    if (!ret.isOk()) {
+        state.SkipWithError(ret.description().c_str());
+        return false;
+    }
+    return true;
+}
+
+static void BM_Scalars(benchmark::State& state, const Services& services) {
+    for (auto _ : state) {
+        if (!checkOk(state, services.foo->doQuiteABit(1, 2, 3.0f, 4.0))) break;
+    }
+}
+
+static void BM_Strings(benchmark::State& state, const Services& services) {
+    hidl_array<hidl_string, 3> in;
+    for (size_t i = 0; i < 3; ++i) {
+        in[i] = std::string(state.range(0), 'x');
+    }
+
+    for (auto _ : state) {
+        if (!checkOk(state, services.foo->haveSomeStrings(in, [](const auto&) {}))) break;
+    }
+    state.SetBytesProcessed(state.iterations() * 3 * state.range(0));
+}
+
+static void BM_ByteVector(benchmark::State& state, const Services& services) {
+    hidl_vec<uint8_t> in;
+    in.resize(state.range(0));
+
+    // sendVec echoes the vector back.
+    for (auto _ : state) {
+        if (!checkOk(state, services.foo->sendVec(in, [](const auto&) {}))) break;
+    }
+    state.SetBytesProcessed(state.iterations() * 2 * state.range(0));
+}
+
+static void BM_IntVector(benchmark::State& state, const Services& services) {
+    hidl_vec<int32_t> in;
+    in.resize(state.range(0));
+
+    for (auto _ : state) {
+        if (!checkOk(state, services.foo->mapThisVector(in, [](const auto&) {}))) break;
+    }
+    state.SetBytesProcessed(state.iterations() * 2 * state.range(0) * sizeof(int32_t));
+}
+
+static void BM_NestedArray(benchmark::State& state, const Services& services) {
+    hidl_array<float, 3, 5> in;
+    for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 5; ++j) {
+            in[i][j] = i * 5 + j;
+        }
+    }
+
+    for (auto _ : state) {
+        if (!checkOk(state, services.foo->transposeMe(in, [](const auto&) {}))) break;
+    }
+}
+
+static void BM_NestedStringArray(benchmark::State& state, const Services& services) {
+    hidl_array<hidl_string, 5, 3> in;
+    for (size_t i = 0; i < 5; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            in[i][j] = std::to_string(i * 3 + j);
+        }
+    }
+
+    for (auto _ : state) {
+        if (!checkOk(state, services.foo->transpose2(in, [](const auto&) {}))) break;
+    }
+}
+
+static void BM_Handle(benchmark::State& state, const Services& services) {
+    Abc xyz;
+    xyz.z = nullptr;
+
+    for (auto _ : state) {
+        if (!checkOk(state, services.bar->expectNullHandle(nullptr, xyz, [](bool, bool) {}))) {
+            break;
+        }
+    }
+}
+
+static void BM_Memory(benchmark::State& state, const Services& services) {
+    if (gMemory.handle() == nullptr) {
+        state.SkipWithError("Could not allocate memory.");
+        return;
+    }
+
+    for (auto _ : state) {
+        if (!checkOk(state, services.memoryTest->haveSomeMemory(gMemory, [](const auto&) {}))) {
+            break;
+        }
+    }
+}
+
+static void BM_Interfaces(benchmark::State& state, const Services& services) {
+    hidl_vec<sp<ISimple>> in;
+    in.resize(state.range(0));
+    for (size_t i = 0; i < in.size(); ++i) {
+        in[i] = new Simple(i);
+    }
+
+    for (auto _ : state) {
+        if (!checkOk(state, services.foo->haveAVectorOfInterfaces(in, [](const auto&) {}))) {
+            break;
+        }
+    }
+}
+
+static void BM_Callback(benchmark::State& state, const Services& services) {
+    if (services.baz == nullptr) {
+        state.SkipWithError("No IBaz service.");
+        return;
+    }
+
+    // IBaz::callMe calls heyItsMe on the callback before it returns.
+    sp<BazCallback> callback = new BazCallback();
+    for (auto _ : state) {
+        if (!checkOk(state, services.baz->callMe(callback))) break;
+    }
+    if (callback->calls != static_cast<size_t>(state.iterations())) {
+        state.SkipWithError("The callback wasn't called.");
+    }
+}
+
+static Services getServices(bool getStub) {
+    Services services;
+    services.foo = IFoo::getService("foo", getStub);
+    services.bar = IBar::getService("foo", getStub);
+    services.memoryTest = IMemoryTest::getService("memory", getStub);
+    // hidl_test_servers only serves IBaz as "dyingBaz", which dies on request.
+    services.baz = IBaz::getService("dyingBaz", getStub);
+    return services;
+}
+
+static bool isAvailable(const Services& services, bool remote) {
+    return services.foo != nullptr && services.foo->isRemote() == remote &&
+           services.bar != nullptr && services.memoryTest != nullptr;
+}
+
+static void registerBenchmarks(const std::string& mode, const Services& services) {
+    using BenchmarkFunction = void (*)(benchmark::State&, const Services&);
+    auto add = [&](const std::string& name, BenchmarkFunction function) {
+        return benchmark::RegisterBenchmark((name + "/" + mode).c_str(), function, services);
+    };
+
+    add("Scalars", BM_Scalars);
+    add("Strings", BM_Strings)->Arg(0)->Arg(64)->Arg(4096);
+    add("ByteVector", BM_ByteVector)->Arg(0)->Arg(64)->Arg(4096)->Arg(65536);
+    add("IntVector", BM_IntVector)->Arg(0)->Arg(64)->Arg(4096);
+    add("NestedArray", BM_NestedArray);
+    add("NestedStringArray", BM_NestedStringArray);
+    add("Handle", BM_Handle);
+    add("Memory", BM_Memory);
+    add("Interfaces", BM_Interfaces)->Arg(1)->Arg(16);
+    add("Callback", BM_Callback);
+}
+
+int main(int argc, char** argv) {
+    setenv("TREBLE_TESTING_OVERRIDE", "true", true);
+    // For the calls of binderized services into BazCallback.
+    ::android::hardware::configureRpcThreadpool(1, false /* callerWillJoin */);
+
+    sp<IAllocator> ashmemAllocator = IAllocator::getService("ashmem");
+    if (ashmemAllocator != nullptr) {
+        ashmemAllocator->allocate(4096, [&](bool success, const hidl_memory& memory) {
+            if (success) gMemory = memory;
+        }).isOk();
+    }
+
+    Services passthrough = getServices(true /* getStub */);
+    if (isAvailable(passthrough, false /* remote */)) {
+        registerBenchmarks("passthrough", passthrough);
+    } else {
+        fprintf(stderr, "No passthrough implementations, skipping passthrough benchmarks.\n");
+    }
+
+    Services binderized = getServices(false /* getStub */);
+    if (isAvailable(binderized, true /* remote */)) {
+        registerBenchmarks("binderized", binderized);
+    } else {
+        fprintf(stderr, "hidl_test_servers isn't running, skipping binderized benchmarks.\n");
+    }
+
+    // Later arguments take precedence, so the default goes first.
+    std::vector<char*> args(argv, argv + argc);
+    static char jsonFormat[] = "--benchmark_format=json";
+    args.insert(args.begin() + 1, jsonFormat);
+    int argCount = args.size();
+
+    benchmark::Initialize(&argCount, args.data());
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -16,10 +16,19 @@
 
 #define LOG_TAG "libhidl-gen-utils"
 
+#include <android-base/file.h>
+#include <android-base/test_utils.h>
 #include <gtest/gtest.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <Arena.h>
 #include <ConstantExpression.h>
 #include <Coordinator.h>
+#include <EnumType.h>
+#include <OutputArchive.h>
+#include <hidl-hash/Hash.h>
 #include <hidl-util/FQName.h>
 
 #define EXPECT_EQ_OK(expectResult, call, ...)        \
@@ -92,6 +101,35 @@ TEST_F(HidlGenHostTest, CoordinatorFilepathTest) {
     EXPECT_EQ_OK("foo/a/b/c/V1_2/", coordinator.getFilepath, kName, Location::GEN_SANITIZED, "");
 }
 
+TEST_F(HidlGenHostTest, LazyImportTest) {
+    TemporaryDir dir;
+    auto write = [&](const std::string& path, const std::string& content) {
+        std::string fullPath = std::string(dir.path) + "/" + path;
+        for (size_t i = fullPath.find('/', 1); i != std::string::npos;
+             i = fullPath.find('/', i + 1)) {
+            mkdir(fullPath.substr(0, i).c_str(), 0700);
+        }
+        ASSERT_TRUE(base::WriteStringToFile(content, fullPath));
+    };
+
+    write("android/hidl/base/1.0/IBase.hal", "package android.hidl.base@1.0; interface IBase {};");
+    write("t/a/1.0/types.hal", "package t.a@1.0; struct Foo { int32_t x; };");
+    write("t/a/1.0/IA.hal", "package t.a@1.0; import t.b@1.0; interface IA { foo(Foo foo); };");
+    // Fails to parse if t.b@1.0 is ever parsed.
+    write("t/b/1.0/IB.hal", "package t.b@1.0; not hidl");
+
+    Coordinator coordinator;
+    std::string error;
+    ASSERT_EQ(OK, coordinator.addPackagePath("android.hidl",
+                                             std::string(dir.path) + "/android/hidl", &error));
+    ASSERT_EQ(OK, coordinator.addPackagePath("t", std::string(dir.path) + "/t", &error));
+
+    // Foo is found in the package's own types.hal, so the whole-package
+    // import is never parsed.
+    EXPECT_NE(nullptr, coordinator.parse(FQName("t.a@1.0::IA"), nullptr /* parsedASTs */,
+                                         Coordinator::Enforce::NONE));
+}
+
 TEST_F(HidlGenHostTest, LocationTest) {
     Location a{{"file", 3, 4}, {"file", 3, 5}};
     Location b{{"file", 3, 6}, {"file", 3, 7}};
@@ -105,6 +143,181 @@ TEST_F(HidlGenHostTest, LocationTest) {
     EXPECT_FALSE(Location::inSameFile(a, other));
 }
 
+TEST_F(HidlGenHostTest, ArenaTest) {
+    static std::vector<int> destroyed;
+    struct Node {
+        explicit Node(int value) : value(value) {}
+        ~Node() { destroyed.push_back(value); }
+        int value;
+    };
+
+    // Trivially destructible, and too large for the shared blocks.
+    struct alignas(64) Buffer {
+        char data[32 * 1024];
+    };
+    static_assert(std::is_trivially_destructible<Buffer>::value, "Buffer is destroyed");
+
+    {
+        Arena arena;
+
+        Node* node = arena.make<Node>(42);
+        EXPECT_EQ(42, node->value);
+
+        uint64_t* number = arena.make<uint64_t>(7u);
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(number) % alignof(uint64_t));
+
+        size_t bytesAllocated = arena.bytesAllocated();
+        Buffer* big = arena.make<Buffer>();
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(big) % alignof(Buffer));
+        EXPECT_EQ(bytesAllocated + sizeof(Buffer), arena.bytesAllocated());
+        memset(big->data, 'x', sizeof(big->data));
+
+        // The oversized buffer has a block of its own, so smaller nodes keep
+        // using the current block.
+        Node* next = arena.make<Node>(43);
+        EXPECT_EQ(43, next->value);
+        EXPECT_TRUE(reinterpret_cast<char*>(next) < big->data ||
+                    reinterpret_cast<char*>(next) >= big->data + sizeof(big->data));
+        EXPECT_LT(reinterpret_cast<char*>(next) - reinterpret_cast<char*>(node), 1024);
+        EXPECT_EQ('x', big->data[sizeof(big->data) - 1]);
+
+        const char* foo = arena.intern("foo");
+        EXPECT_STREQ("foo", foo);
+        EXPECT_EQ(foo, arena.intern(std::string("foo")));
+        EXPECT_EQ(foo, arena.intern("foobar", 3));
+        EXPECT_NE(foo, arena.intern("foobar"));
+
+        arena.adopt(new Node(1));
+        EXPECT_TRUE(destroyed.empty());
+    }
+
+    // Nodes are destroyed in reverse order of creation.
+    EXPECT_EQ((std::vector<int>{1, 43, 42}), destroyed);
+}
+
+TEST_F(HidlGenHostTest, ConstantExpressionTest) {
+    auto lval = ConstantExpression::ValueOf(ScalarType::KIND_INT32, 1);
+    auto rval = ConstantExpression::ValueOf(ScalarType::KIND_INT64, 2);
+    BinaryConstantExpression sum(lval.get(), "<<", rval.get());
+
+    sum.evaluate();
+    EXPECT_EQ("4", sum.value());
+    EXPECT_EQ("4", sum.cppValue());
+    EXPECT_EQ("(1 << 2)", sum.description());
+    EXPECT_FALSE(sum.descriptionIsTrivial());
+}
+
+TEST_F(HidlGenHostTest, AutofillConstantExpressionTest) {
+    EnumType enumType("E", FQName("a.b@1.0::E"), Location(), Reference<Type>(), nullptr);
+
+    // Evaluates the value following one of prevKind, in an enum of baseKind.
+    auto autofill = [&](ScalarType::Kind prevKind, uint64_t prevValue, ScalarType::Kind baseKind,
+                        std::string* description) {
+        auto prevExpr = ConstantExpression::ValueOf(prevKind, prevValue);
+        EnumValue prev("A", prevExpr.get(), Location());
+        AutofillConstantExpression next(&enumType, &prev, Location(), baseKind);
+        next.evaluate();
+        if (description != nullptr) *description = next.description();
+        return next.value();
+    };
+
+    EXPECT_EQ("1", autofill(ScalarType::KIND_INT32, 0, ScalarType::KIND_INT32, nullptr));
+    EXPECT_EQ("-1", autofill(ScalarType::KIND_INT64, static_cast<uint64_t>(-2),
+                             ScalarType::KIND_INT64, nullptr));
+
+    // Both operands are promoted to int32 first, so uint8 doesn't wrap around.
+    EXPECT_EQ("256", autofill(ScalarType::KIND_UINT8, 255, ScalarType::KIND_UINT8, nullptr));
+    EXPECT_EQ("-127", autofill(ScalarType::KIND_INT8, static_cast<uint64_t>(-128),
+                               ScalarType::KIND_INT8, nullptr));
+
+    // The usual arithmetic conversions pick the unsigned kind, which wraps around.
+    EXPECT_EQ("0", autofill(ScalarType::KIND_UINT32, 0xffffffff, ScalarType::KIND_INT8, nullptr));
+    EXPECT_EQ("0", autofill(ScalarType::KIND_UINT64, UINT64_MAX, ScalarType::KIND_UINT8, nullptr));
+    EXPECT_EQ("4294967296",
+              autofill(ScalarType::KIND_INT64, 0xffffffff, ScalarType::KIND_UINT32, nullptr));
+
+    std::string description;
+    EXPECT_EQ("8", autofill(ScalarType::KIND_UINT16, 7, ScalarType::KIND_UINT16, &description));
+    EXPECT_EQ("(" + enumType.fullName() + ".A implicitly + 1)", description);
+}
+
+TEST_F(HidlGenHostTest, ConstantExpressionDescriptionTest) {
+    auto one = ConstantExpression::ValueOf(ScalarType::KIND_INT32, 1);
+    EXPECT_EQ("1", one->description());
+    EXPECT_TRUE(one->descriptionIsTrivial());
+
+    auto two = ConstantExpression::ValueOf(ScalarType::KIND_INT32, 2);
+    auto three = ConstantExpression::ValueOf(ScalarType::KIND_INT32, 3);
+    BinaryConstantExpression sum(one.get(), "+", two.get());
+    UnaryConstantExpression negated("-", &sum);
+    BinaryConstantExpression product(&negated, "*", three.get());
+
+    // Operands are evaluated first, as in the post parse pass.
+    sum.evaluate();
+    negated.evaluate();
+    product.evaluate();
+    EXPECT_EQ("-9", product.value());
+    EXPECT_EQ("(-(1 + 2) * 3)", product.description());
+    // The formatted description is kept, not formatted again.
+    EXPECT_EQ(&product.description(), &product.description());
+    EXPECT_EQ("(1 + 2)", sum.description());
+}
+
+TEST_F(HidlGenHostTest, HashFileTest) {
+    TemporaryFile file;
+    ASSERT_TRUE(base::WriteStringToFile("# comment\n"
+                                        "\n"
+                                        "0a1b a.b@1.0::IFoo\n"
+                                        "  2c3d a.b@1.0::IFoo  # again\n"
+                                        "4e5f a.b@1.0::IBar\n",
+                                        file.path));
+
+    std::string error;
+    bool fileExists = false;
+    EXPECT_EQ((std::vector<std::string>{"0a1b", "2c3d"}),
+              Hash::lookupHash(file.path, "a.b@1.0::IFoo", &error, &fileExists));
+    EXPECT_TRUE(error.empty());
+    EXPECT_TRUE(fileExists);
+    EXPECT_TRUE(Hash::lookupHash(file.path, "a.b@1.0::IBaz", &error).empty());
+
+    TemporaryFile badFile;
+    ASSERT_TRUE(base::WriteStringToFile("0A1B a.b@1.0::IFoo\n", badFile.path));
+    EXPECT_TRUE(Hash::lookupHash(badFile.path, "a.b@1.0::IFoo", &error, &fileExists).empty());
+    EXPECT_FALSE(error.empty());
+    EXPECT_TRUE(fileExists);
+}
+
+TEST_F(HidlGenHostTest, OutputArchiveTest) {
+    TemporaryDir dir;
+    const std::string path = std::string(dir.path) + "/out.tar";
+
+    std::unique_ptr<OutputArchive> archive = OutputArchive::Open(path);
+    ASSERT_NE(nullptr, archive);
+    FILE* file = archive->openEntry("a/b/IFoo.h");
+    ASSERT_NE(nullptr, file);
+    fputs("foo", file);
+    EXPECT_EQ(0, fclose(file));
+    EXPECT_EQ(OK, archive->close());
+
+    std::string content;
+    ASSERT_TRUE(base::ReadFileToString(path, &content));
+    // header, one block of content, two empty blocks
+    ASSERT_EQ(4u * 512u, content.size());
+    EXPECT_STREQ("a/b/IFoo.h", content.c_str());
+    EXPECT_EQ("foo", content.substr(512, 3));
+
+    EXPECT_EQ(nullptr, OutputArchive::Open(std::string(dir.path) + "/out.unknown"));
+
+    // An archive with an entry which couldn't be added is removed.
+    const std::string zipPath = std::string(dir.path) + "/out.zip";
+    archive = OutputArchive::Open(zipPath);
+    ASSERT_NE(nullptr, archive);
+    EXPECT_EQ(OK, archive->add("IFoo.java", "foo"));
+    EXPECT_NE(OK, archive->add("IFoo.java", "bar"));
+    EXPECT_NE(OK, archive->close());
+    EXPECT_NE(0, access(zipPath.c_str(), F_OK));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -83,12 +83,9 @@ function do_makefiles_update() {
 
   check_dirs "$root_or_cwd" $@ || return 1
 
-  local packages=$(get_packages $current_dir $current_package) || return 1
   local root_arguments=$(get_root_arguments $@) || return 1
+  local threads=$(getconf _NPROCESSORS_ONLN 2> /dev/null || echo 1)
 
-  for p in $packages; do
-    echo "Updating $p";
-    hidl-gen -O "$owner" -Landroidbp $root_arguments $p;
-    rc=$?; if [[ $rc != 0 ]]; then return $rc; fi
-  done
+  # hidl-gen updates every package under the root, printing "Updating <package>" for each.
+  hidl-gen -O "$owner" -Landroidbp -j "$threads" $root_arguments $current_package
 }